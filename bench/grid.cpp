@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <spatial/grid.hpp>
+#include <spatial/utils/permutation.hpp>
+
+/*
+ * Every benchmark takes two arguments: the number of bodies, and the cell size in percent of the query radius.
+ * The world grows with the number of bodies so that the average density stays at one body per unit area, which
+ * gives about 12.6 neighbors per body within RADIUS for the uniform workload.
+ *
+ * Each benchmark reports time per iteration, bodies/s (items_per_second) and time per body (time_per_body).
+ */
+
+struct Body{
+public:
+    std::array<float, 2> position;
+};
+
+struct BodyPositionGetter{
+    spatial::Vector2f operator()(const Body &body) const noexcept{
+        return { body.position[0], body.position[1] };
+    }
+};
+
+using Grid = spatial::Grid<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>>;
+
+constexpr float RADIUS = 2.f;
+
+enum class Distribution{
+    Uniform, // Bodies are scattered over the world.
+    Clustered, // Bodies are packed in Gaussian clusters of about 1024 bodies.
+};
+
+struct Workload{
+    float world_size;
+    std::vector<Body> bodies;
+
+    Workload(std::size_t body_count, Distribution distribution) : world_size(std::sqrt(static_cast<float>(body_count))) {
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> world_dis { 0.f, world_size };
+
+        bodies.reserve(body_count);
+        if (distribution == Distribution::Uniform){
+            for (std::size_t i = 0; i < body_count; ++i){
+                bodies.push_back(Body { { world_dis(gen), world_dis(gen) } });
+            }
+        }
+        else{
+            std::vector<std::array<float, 2>> centers(std::max<std::size_t>(body_count / 1024, 1));
+            for (auto &center : centers){
+                center = { world_dis(gen), world_dis(gen) };
+            }
+
+            std::uniform_int_distribution<std::size_t> center_dis { 0, centers.size() - 1 };
+            std::normal_distribution<float> offset_dis { 0.f, 4.f * RADIUS };
+            for (std::size_t i = 0; i < body_count; ++i){
+                const auto &center = centers[center_dis(gen)];
+                bodies.push_back(Body { {
+                    std::clamp(center[0] + offset_dis(gen), 0.f, std::nextafter(world_size, 0.f)),
+                    std::clamp(center[1] + offset_dis(gen), 0.f, std::nextafter(world_size, 0.f)),
+                } });
+            }
+        }
+    }
+
+    Grid makeGrid(const benchmark::State &state) const{
+        const auto cell_size = RADIUS * static_cast<float>(state.range(1)) / 100.f;
+        const auto cells = std::max<std::size_t>(static_cast<std::size_t>(std::ceil(world_size / cell_size)), 1);
+        return Grid(spatial::FloatRect(0, 0, world_size, world_size), cells, cells);
+    }
+};
+
+void setCounters(benchmark::State &state, std::size_t body_count){
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * body_count));
+    state.counters["time_per_body"] = benchmark::Counter(static_cast<double>(body_count), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+template <Distribution D>
+void BM_addBody(benchmark::State &state){
+    Workload workload(state.range(0), D);
+    auto grid = workload.makeGrid(state);
+
+    for (auto _ : state){
+        grid.clearAllBodies();
+        for (auto &body : workload.bodies){
+            benchmark::DoNotOptimize(grid.addBody(&body));
+        }
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+template <Distribution D>
+void BM_assign(benchmark::State &state){
+    Workload workload(state.range(0), D);
+    auto grid = workload.makeGrid(state);
+
+    std::vector<Body*> references;
+    for (auto &body : workload.bodies){
+        references.push_back(&body);
+    }
+
+    for (auto _ : state){
+        grid.assign(references);
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+template <Distribution D>
+void BM_updateBodyCell(benchmark::State &state){
+    Workload workload(state.range(0), D);
+    auto grid = workload.makeGrid(state);
+
+    std::vector<Grid::BodyHandle> handles;
+    for (auto &body : workload.bodies){
+        handles.push_back(grid.addBody(&body));
+    }
+
+    // Moving bodies alternate between two positions, with a step typical for a frame.
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> step_dis { -0.1f * RADIUS, 0.1f * RADIUS };
+    std::vector<std::array<float, 2>> positions[2];
+    for (const auto &body : workload.bodies){
+        positions[0].push_back(body.position);
+        positions[1].push_back({
+            std::clamp(body.position[0] + step_dis(gen), 0.f, std::nextafter(workload.world_size, 0.f)),
+            std::clamp(body.position[1] + step_dis(gen), 0.f, std::nextafter(workload.world_size, 0.f)),
+        });
+    }
+
+    std::size_t frame = 0;
+    for (auto _ : state){
+        const auto &frame_positions = positions[++frame % 2];
+        for (std::size_t i = 0; i < handles.size(); ++i){
+            workload.bodies[i].position = frame_positions[i];
+            grid.updateBodyCell(handles[i]);
+        }
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+template <Distribution D>
+void BM_queryDistance(benchmark::State &state){
+    Workload workload(state.range(0), D);
+    auto grid = workload.makeGrid(state);
+
+    std::vector<Grid::BodyHandle> handles;
+    for (auto &body : workload.bodies){
+        handles.push_back(grid.addBody(&body));
+    }
+
+    for (auto _ : state){
+        std::size_t neighbor_count = 0;
+        for (const auto handle : handles){
+            grid.queryDistance(handle, RADIUS, [&](Body&){ ++neighbor_count; });
+        }
+        benchmark::DoNotOptimize(neighbor_count);
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+template <Distribution D>
+void BM_queryDistancePair(benchmark::State &state){
+    Workload workload(state.range(0), D);
+    auto grid = workload.makeGrid(state);
+    for (auto &body : workload.bodies){
+        grid.addBody(&body);
+    }
+
+    for (auto _ : state){
+        std::size_t pair_count = 0;
+        grid.queryDistancePair(RADIUS, [&](Body&, Body&){ ++pair_count; });
+        benchmark::DoNotOptimize(pair_count);
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+/**
+ * @brief Counter of a thread, padded to its own cache line so that threads do not share a line.
+ */
+struct alignas(64) ThreadCount{
+    std::size_t value = 0;
+};
+
+template <Distribution D>
+void BM_queryDistancePairParallel(benchmark::State &state){
+    Workload workload(state.range(0), D);
+    auto grid = workload.makeGrid(state);
+    for (auto &body : workload.bodies){
+        grid.addBody(&body);
+    }
+
+    const auto num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    std::vector<ThreadCount> pair_counts(num_threads);
+    for (auto _ : state){
+        grid.queryDistancePair(RADIUS, num_threads, [&](Body&, Body&, std::size_t thread_index){ ++pair_counts[thread_index].value; });
+        benchmark::DoNotOptimize(pair_counts.data());
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+// Body counts from 1k to 1M, and cell sizes from half to four times the query radius.
+#define SPATIAL_BENCHMARK(func) \
+    BENCHMARK_TEMPLATE(func, Distribution::Uniform) \
+        ->ArgNames({ "bodies", "cell_pct" })->ArgsProduct({ { 1 << 10, 1 << 14, 1 << 17, 1 << 20 }, { 50, 100, 200, 400 } }) \
+        ->Unit(benchmark::kMicrosecond); \
+    BENCHMARK_TEMPLATE(func, Distribution::Clustered) \
+        ->ArgNames({ "bodies", "cell_pct" })->ArgsProduct({ { 1 << 10, 1 << 14, 1 << 17, 1 << 20 }, { 50, 100, 200, 400 } }) \
+        ->Unit(benchmark::kMicrosecond)
+
+SPATIAL_BENCHMARK(BM_addBody);
+SPATIAL_BENCHMARK(BM_assign);
+SPATIAL_BENCHMARK(BM_updateBodyCell);
+SPATIAL_BENCHMARK(BM_queryDistance);
+SPATIAL_BENCHMARK(BM_queryDistancePair);
+SPATIAL_BENCHMARK(BM_queryDistancePairParallel);
+
+// Cell layouts compared on large grids, where rows of cells no longer fit in cache. Cell size is the query radius.
+template <spatial::utils::MatrixLayout Layout>
+void BM_queryDistanceLayout(benchmark::State &state){
+    using LayoutGrid = spatial::Grid<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>, Layout>;
+
+    Workload workload(state.range(0), Distribution::Uniform);
+    const auto cells = std::max<std::size_t>(static_cast<std::size_t>(std::ceil(workload.world_size / RADIUS)), 1);
+    LayoutGrid grid(spatial::FloatRect(0, 0, workload.world_size, workload.world_size), cells, cells);
+
+    // Bodies are queried in insertion order, which is random in space, as user arrays usually are.
+    std::vector<typename LayoutGrid::BodyHandle> handles;
+    for (auto &body : workload.bodies){
+        handles.push_back(grid.addBody(&body));
+    }
+
+    for (auto _ : state){
+        std::size_t neighbor_count = 0;
+        for (const auto handle : handles){
+            grid.queryDistance(handle, RADIUS, [&](Body&){ ++neighbor_count; });
+        }
+        benchmark::DoNotOptimize(neighbor_count);
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+BENCHMARK_TEMPLATE(BM_queryDistanceLayout, spatial::utils::RowMajorLayout)
+    ->ArgName("bodies")->Arg(1 << 17)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_queryDistanceLayout, spatial::utils::TiledLayout<>)
+    ->ArgName("bodies")->Arg(1 << 17)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_queryDistanceLayout, spatial::utils::MortonLayout)
+    ->ArgName("bodies")->Arg(1 << 17)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+// Queries of every body in user array order, before and after the array is sorted by getSpatialOrder.
+template <bool Sorted>
+void BM_queryDistanceSpatialOrder(benchmark::State &state){
+    using IndexGrid = spatial::Grid<float, Body, BodyPositionGetter, spatial::IndexBodyStorage<Body>>;
+
+    Workload workload(state.range(0), Distribution::Uniform);
+    const auto cells = std::max<std::size_t>(static_cast<std::size_t>(std::ceil(workload.world_size / RADIUS)), 1);
+    IndexGrid grid(spatial::FloatRect(0, 0, workload.world_size, workload.world_size), cells, cells,
+                   spatial::IndexBodyStorage<Body> { workload.bodies });
+
+    const auto body_count = static_cast<unsigned>(workload.bodies.size());
+    grid.assign(std::views::iota(0U, body_count));
+    if constexpr (Sorted){
+        spatial::utils::applyPermutation(grid.getSpatialOrder(), workload.bodies);
+        grid.assign(std::views::iota(0U, body_count));
+    }
+
+    for (auto _ : state){
+        std::size_t neighbor_count = 0;
+        for (unsigned i = 0; i < body_count; ++i){
+            grid.queryDistance(grid.getBodyHandle(i), RADIUS, [&](Body&){ ++neighbor_count; });
+        }
+        benchmark::DoNotOptimize(neighbor_count);
+    }
+    setCounters(state, workload.bodies.size());
+}
+
+BENCHMARK_TEMPLATE(BM_queryDistanceSpatialOrder, false)
+    ->ArgName("bodies")->Arg(1 << 14)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_queryDistanceSpatialOrder, true)
+    ->ArgName("bodies")->Arg(1 << 14)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,63 @@
+#ifndef SPATIAL_BODY_STORAGE_HPP
+#define SPATIAL_BODY_STORAGE_HPP
+
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace spatial{
+    /**
+     * @brief Policy that decides how \p Grid refers to its bodies.
+     *
+     * \p reference_type is what the grid stores per body, and \p get resolves it to the body. A custom policy can be
+     * used for, e.g., entity IDs of an ECS by resolving them in \p get.
+     */
+    template <typename Storage, typename Body>
+    concept BodyStorage = std::semiregular<typename Storage::reference_type> &&
+                          requires(const Storage &storage, const typename Storage::reference_type &reference){
+        { storage.get(reference) } -> std::same_as<Body&>;
+    };
+
+    /**
+     * @brief Bodies are shared with the grid by \p std::shared_ptr.
+     */
+    template <typename Body>
+    struct SharedBodyStorage{
+        using reference_type = std::shared_ptr<Body>;
+
+        Body &get(const reference_type &reference) const noexcept{
+            return *reference;
+        }
+    };
+
+    /**
+     * @brief Bodies are owned by user, and the grid refers to them by raw pointers.
+     */
+    template <typename Body>
+    struct PointerBodyStorage{
+        using reference_type = Body*;
+
+        Body &get(reference_type reference) const noexcept{
+            return *reference;
+        }
+    };
+
+    /**
+     * @brief Bodies are in a user array, and the grid refers to them by their indices.
+     *
+     * The array must outlive the grid, and must not be reallocated while the grid refers to it.
+     */
+    template <typename Body, std::unsigned_integral Index = std::uint32_t>
+    struct IndexBodyStorage{
+        using reference_type = Index;
+
+        std::span<Body> bodies;
+
+        Body &get(reference_type reference) const noexcept{
+            return bodies[reference];
+        }
+    };
+};
+
+#endif //SPATIAL_BODY_STORAGE_HPP
@@ -0,0 +1,162 @@
+#ifndef SPATIAL_CONTACT_TRACKER_HPP
+#define SPATIAL_CONTACT_TRACKER_HPP
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include "grid.hpp"
+#include "utils/counting_sort.hpp"
+
+namespace spatial{
+    /**
+     * @brief Persistent set of body pairs within a distance in a \p Grid, which reports only the pairs that begin or
+     * end contact between updates.
+     *
+     * Contacts are kept as a sorted list between updates. Each update enumerates all pairs of the grid once, orders
+     * them by slot indices with two counting sort passes and merges them against the previous list in a single linear
+     * pass, so no pair is hashed or compared for sorting. An update costs O(pairs + slots) regardless of how many pairs
+     * change; only the invocations of the event callbacks scale with the number of transitions.
+     */
+    template <std::floating_point T, typename Body, typename PositionGetter, BodyStorage<Body> Storage = SharedBodyStorage<Body>,
+              utils::MatrixLayout CellLayout = utils::RowMajorLayout>
+    class ContactTracker{
+    public:
+        using grid_t = Grid<T, Body, PositionGetter, Storage, CellLayout>;
+        using BodyHandle = typename grid_t::BodyHandle;
+
+        /**
+         * @brief Pair of bodies in contact. Index of \p first is less than index of \p second.
+         */
+        struct Contact{
+            BodyHandle first;
+            BodyHandle second;
+
+            bool operator==(const Contact&) const noexcept = default;
+        };
+
+    private:
+        std::vector<Contact> contacts; // Contacts of the last update, in ascending order of key.
+        std::vector<Contact> next_contacts; // Scratch buffers of update.
+        std::vector<Contact> sorted_contacts;
+        std::vector<std::uint32_t> sort_buckets;
+        std::vector<std::uint32_t> sort_offsets;
+        std::vector<std::uint32_t> sort_order;
+        utils::CountingSortBuffers sort_buffers;
+
+        static auto key(const Contact &contact) noexcept{
+            return std::tuple { contact.first.index, contact.second.index, contact.first.generation, contact.second.generation };
+        }
+
+        /**
+         * @brief Stably sort \p next_contacts by slot index of the body of \p member, in O(contacts + \p slot_count).
+         */
+        void sortNextContacts(std::size_t slot_count, BodyHandle Contact::*member){
+            sort_buckets.resize(next_contacts.size());
+            for (std::size_t i = 0; i < next_contacts.size(); ++i){
+                sort_buckets[i] = (next_contacts[i].*member).index;
+            }
+            sort_offsets.resize(slot_count + 1);
+            sort_order.resize(next_contacts.size());
+            utils::countingSort(sort_buckets, sort_offsets, sort_order, sort_buffers);
+
+            sorted_contacts.resize(next_contacts.size());
+            for (std::size_t i = 0; i < next_contacts.size(); ++i){
+                sorted_contacts[i] = next_contacts[sort_order[i]];
+            }
+            std::swap(next_contacts, sorted_contacts);
+        }
+
+    public:
+        /**
+         * @brief Update contacts to the body pairs of \p grid whose distance is less than \p distance.
+         *
+         * Bodies removed from \p grid since the last update end all their contacts, and their stale handles are passed
+         * to \p on_end.
+         *
+         * @param grid Grid of bodies, whose cells and cached positions are up to date.
+         * @param distance Distance of contact.
+         * @param on_begin Function to be invoked with handles of both bodies of each pair that begins contact.
+         * @param on_end Function to be invoked with handles of both bodies of each pair that ends contact.
+         */
+        template <std::invocable<BodyHandle, BodyHandle> BeginVisitor, std::invocable<BodyHandle, BodyHandle> EndVisitor>
+        void update(const grid_t &grid, T distance, BeginVisitor &&on_begin, EndVisitor &&on_end){
+            next_contacts.clear();
+            grid.queryDistancePairHandles(distance, [&](BodyHandle handle1, BodyHandle handle2){
+                if (handle1.index < handle2.index){
+                    next_contacts.push_back({ handle1, handle2 });
+                }
+                else{
+                    next_contacts.push_back({ handle2, handle1 });
+                }
+            });
+
+            // Sort by second index, then stably by first index, which orders them by key as each slot index has a
+            // single generation at a time.
+            sortNextContacts(grid.getSlotCount(), &Contact::second);
+            sortNextContacts(grid.getSlotCount(), &Contact::first);
+
+            // Merge sorted lists: contacts only in the previous list end, and ones only in the next list begin.
+            auto previous = contacts.cbegin();
+            auto next = next_contacts.cbegin();
+            while (previous != contacts.cend() && next != next_contacts.cend()){
+                const auto previous_key = key(*previous);
+                const auto next_key = key(*next);
+                if (previous_key < next_key){
+                    on_end(previous->first, previous->second);
+                    ++previous;
+                }
+                else if (next_key < previous_key){
+                    on_begin(next->first, next->second);
+                    ++next;
+                }
+                else{
+                    ++previous;
+                    ++next;
+                }
+            }
+            for (; previous != contacts.cend(); ++previous){
+                on_end(previous->first, previous->second);
+            }
+            for (; next != next_contacts.cend(); ++next){
+                on_begin(next->first, next->second);
+            }
+
+            std::swap(contacts, next_contacts);
+        }
+
+        /**
+         * @brief Get contacts of the last update, which includes the pairs that stay in contact.
+         *
+         * @return Span of contacts, in ascending order of body indices.
+         */
+        [[nodiscard]] std::span<const Contact> getContacts() const noexcept{
+            return contacts;
+        }
+
+        /**
+         * @brief Check if bodies of \p handle1 and \p handle2 were in contact at the last update, in O(log n).
+         *
+         * @param handle1 Handle of a body.
+         * @param handle2 Handle of another body.
+         * @return true if they are in contact, false otherwise.
+         */
+        [[nodiscard]] bool isInContact(BodyHandle handle1, BodyHandle handle2) const noexcept{
+            const auto contact = handle1.index < handle2.index ? Contact { handle1, handle2 } : Contact { handle2, handle1 };
+            return std::ranges::binary_search(contacts, key(contact), {}, key);
+        }
+
+        /**
+         * @brief Forget all contacts without invoking any event, e.g. after the grid is cleared.
+         */
+        void clear() noexcept{
+            contacts.clear();
+        }
+    };
+};
+
+#endif //SPATIAL_CONTACT_TRACKER_HPP
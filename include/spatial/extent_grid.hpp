@@ -0,0 +1,461 @@
+#ifndef SPATIAL_EXTENT_GRID_HPP
+#define SPATIAL_EXTENT_GRID_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "body_storage.hpp"
+#include "rect.hpp"
+#include "utils/matrix.hpp"
+#include "utils/slot_map.hpp"
+#include "utils/thrower.hpp"
+#include "utils/macros.hpp"
+
+namespace spatial{
+    /**
+     * @brief Uniform grid of bodies with extents, where each body is registered in every cell its bounds overlap.
+     *
+     * Unlike \p Grid, bodies are not points: \p BoundsGetter gives the axis-aligned bounds of a body, and queries test
+     * the bounds instead of positions. Since a body is found from any cell it overlaps, sizes of bodies may vary freely,
+     * although a body overlapping many cells costs proportionally to add, update and query. A circular body can be
+     * registered by its bounding box.
+     *
+     * A body pair in several common cells is reported only from the first cell of them, i.e. the cell at the maximum
+     * first row and the maximum first column of their cell ranges. So queries never report a body or a pair twice, and
+     * need no deduplication.
+     */
+    template <std::floating_point T, typename Body, typename BoundsGetter, BodyStorage<Body> Storage = SharedBodyStorage<Body>>
+    requires std::invocable<BoundsGetter, const Body&> &&
+             std::is_same_v<std::invoke_result_t<BoundsGetter, const Body&>, Rect<T>>
+    class ExtentGrid{
+    public:
+        using index_t = std::uint32_t;
+        using body_ref_t = typename Storage::reference_type; // How the grid refers to a body.
+
+        /**
+         * @brief Stable handle of a body in grid, returned by \p addBody.
+         */
+        using BodyHandle = utils::SlotHandle;
+
+    private:
+        /**
+         * @brief Range of cells, inclusive on both ends.
+         */
+        struct CellRange{
+            index_t row_first = 0;
+            index_t row_last = 0;
+            index_t col_first = 0;
+            index_t col_last = 0;
+
+            bool operator==(const CellRange&) const noexcept = default;
+
+            [[nodiscard]] bool contains(std::size_t row, std::size_t col) const noexcept{
+                return row_first <= row && row <= row_last && col_first <= col && col <= col_last;
+            }
+        };
+
+        /**
+         * @brief Body with its bounds and the cells it is registered in.
+         */
+        struct Slot{
+            body_ref_t body {};
+            std::array<T, 4> bounds {}; // Left, top, right and bottom of body, captured at addBody and updateBodyCells.
+            CellRange range {};
+        };
+
+        Storage storage;
+        std::size_t rows;
+        std::size_t columns;
+        utils::Matrix<std::vector<index_t>> cells; // Slot indices of bodies overlapping each cell.
+        utils::SlotMap<Slot> slots;
+
+        static std::array<T, 4> toBounds(const Rect<T> &rect) noexcept{
+            return { rect.left(), rect.top(), rect.right(), rect.bottom() };
+        }
+
+        static bool overlaps(const std::array<T, 4> &a, const std::array<T, 4> &b) noexcept{
+            return a[0] <= b[2] && b[0] <= a[2] && a[1] <= b[3] && b[1] <= a[3];
+        }
+
+        /**
+         * @brief Get range of cells that \p bounds overlaps. Parts out of bound are clamped to the border cells.
+         */
+        CellRange getCellRange(const std::array<T, 4> &bounds) const noexcept{
+            const auto cell_size = cellSize();
+            const auto to_index = [](T value, std::size_t count){
+                return static_cast<index_t>(std::clamp(std::floor(value), T { 0 }, static_cast<T>(count - 1)));
+            };
+
+            return {
+                to_index((bounds[1] - bound.top()) / cell_size.y, rows),
+                to_index((bounds[3] - bound.top()) / cell_size.y, rows),
+                to_index((bounds[0] - bound.left()) / cell_size.x, columns),
+                to_index((bounds[2] - bound.left()) / cell_size.x, columns),
+            };
+        }
+
+        /**
+         * @brief Register body of \p slot_index in cells of \p range, except cells of \p skip.
+         */
+        void insertIntoCells(index_t slot_index, const CellRange &range, const CellRange *skip = nullptr){
+            for (auto row = range.row_first; row <= range.row_last; ++row){
+                for (auto col = range.col_first; col <= range.col_last; ++col){
+                    if (!skip || !skip->contains(row, col)){
+                        cells(row, col).push_back(slot_index);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Unregister body of \p slot_index from cells of \p range, except cells of \p skip. It searches the body
+         * in each cell and swaps it with the last one.
+         */
+        void eraseFromCells(index_t slot_index, const CellRange &range, const CellRange *skip = nullptr) noexcept{
+            for (auto row = range.row_first; row <= range.row_last; ++row){
+                for (auto col = range.col_first; col <= range.col_last; ++col){
+                    if (skip && skip->contains(row, col)){
+                        continue;
+                    }
+
+                    auto &cell = cells(row, col);
+                    *std::ranges::find(cell, slot_index) = cell.back();
+                    cell.pop_back();
+                }
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with slot index of each body except \p excluded_slot whose bounds overlap \p bounds.
+         */
+        template <typename F>
+        void visitOverlaps(const std::array<T, 4> &bounds, index_t excluded_slot, F &&func) const{
+            const auto range = getCellRange(bounds);
+            for (auto row = range.row_first; row <= range.row_last; ++row){
+                for (auto col = range.col_first; col <= range.col_last; ++col){
+                    for (auto slot_index : cells(row, col)){
+                        const auto &slot = slots[slot_index];
+
+                        // Report only from the first cell shared with query.
+                        if (slot_index == excluded_slot ||
+                            row != std::max(range.row_first, slot.range.row_first) ||
+                            col != std::max(range.col_first, slot.range.col_first)){
+                            continue;
+                        }
+
+                        if (overlaps(bounds, slot.bounds)){
+                            func(slot_index);
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with slot indices of each body pair whose bounds overlap.
+         */
+        template <typename F>
+        void visitOverlapPairs(F &&func) const{
+            for (std::size_t row = 0; row < rows; ++row){
+                for (std::size_t col = 0; col < columns; ++col){
+                    const auto &cell = cells(row, col);
+                    for (std::size_t i = 0; i < cell.size(); ++i){
+                        const auto &slot1 = slots[cell[i]];
+                        for (std::size_t j = i + 1; j < cell.size(); ++j){
+                            const auto &slot2 = slots[cell[j]];
+
+                            // Report only from the first cell shared by both.
+                            if (row != std::max(slot1.range.row_first, slot2.range.row_first) ||
+                                col != std::max(slot1.range.col_first, slot2.range.col_first)){
+                                continue;
+                            }
+
+                            if (overlaps(slot1.bounds, slot2.bounds)){
+                                func(cell[i], cell[j]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+    public:
+        const Rect<T> bound;
+
+        /**
+         * @param bound Bound of grid.
+         * @param rows Number of rows.
+         * @param columns Number of columns.
+         * @param storage Storage policy that resolves body references.
+         * @throw std::invalid_argument If \p rows or \p columns is 0 in debug mode.
+         */
+        ExtentGrid(const Rect<T> &bound, std::size_t rows, std::size_t columns, const Storage &storage = {})
+                : storage(storage), rows(rows), columns(columns), cells(rows, columns), bound(bound) {
+#ifndef NDEBUG
+            if (rows == 0 || columns == 0) {
+                utils::throwInvalidArgument("ExtentGrid::ExtentGrid: rows and columns must be greater than 0");
+            }
+#endif
+        }
+
+        /**
+         * @brief Get number of rows.
+         * @return Number of rows.
+         */
+        [[nodiscard]] std::size_t getRowCount() const noexcept{
+            return rows;
+        }
+
+        /**
+         * @brief Get number of columns.
+         * @return Number of columns.
+         */
+        [[nodiscard]] std::size_t getColumnCount() const noexcept{
+            return columns;
+        }
+
+        /**
+         * @brief Get cell size of grid.
+         *
+         * @return Cell size in vec2 form (x=width, y=height).
+         */
+        Vector2<T> cellSize() const NOEXCEPT_IF_RELEASE {
+            return bound.size.cwiseDiv(Vector2<T> { static_cast<T>(columns), static_cast<T>(rows) });
+        }
+
+        /**
+         * @brief Get number of bodies in grid.
+         * @return Number of bodies in grid.
+         */
+        [[nodiscard]] std::size_t getBodyCount() const noexcept{
+            return slots.size();
+        }
+
+        /**
+         * @brief Get number of cells that body of \p handle is registered in.
+         *
+         * @param handle Handle of body.
+         * @return Number of cells.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        [[nodiscard]] std::size_t getCellCount(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("ExtentGrid::getCellCount: invalid handle");
+            }
+#endif
+            const auto &range = slots[handle.index].range;
+            return static_cast<std::size_t>(range.row_last - range.row_first + 1) * (range.col_last - range.col_first + 1);
+        }
+
+        /**
+         * @brief Check if \p handle refers to a body in grid.
+         *
+         * @param handle Handle to check.
+         * @return true if body of \p handle is not removed, false otherwise.
+         */
+        [[nodiscard]] bool contains(BodyHandle handle) const noexcept{
+            return slots.contains(handle);
+        }
+
+        /**
+         * @brief Get body of \p handle.
+         *
+         * @param handle Handle of body.
+         * @return Reference of body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        Body &getBody(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("ExtentGrid::getBody: invalid handle");
+            }
+#endif
+            return storage.get(slots[handle.index].body);
+        }
+
+        /**
+         * @brief Add body to grid, registering it in every cell its bounds overlap.
+         *
+         * Bounds may be partially or entirely out of bound, in which case the parts out of bound are registered in
+         * the border cells.
+         *
+         * @param body Reference of body to add, which is convertible to \p body_ref_t.
+         * @return Handle of added body.
+         */
+        BodyHandle addBody(auto &&body){
+            static_assert(std::is_convertible_v<decltype(body), body_ref_t>);
+
+            const auto handle = slots.insert({ .body = std::forward<decltype(body)>(body) });
+            auto &slot = slots[handle.index];
+            slot.bounds = toBounds(BoundsGetter()(storage.get(slot.body)));
+            slot.range = getCellRange(slot.bounds);
+            insertIntoCells(handle.index, slot.range);
+
+            return handle;
+        }
+
+        /**
+         * @brief Remove body from grid.
+         *
+         * @param handle Handle of body to remove. It is invalidated.
+         * @return true if body is removed, false if \p handle was not valid.
+         */
+        bool removeBody(BodyHandle handle) noexcept{
+            if (!contains(handle)){
+                return false;
+            }
+
+            eraseFromCells(handle.index, slots[handle.index].range);
+            slots.erase(handle);
+
+            return true;
+        }
+
+        /**
+         * @brief Clear all bodies in grid. All handles are invalidated.
+         */
+        void clearAllBodies() noexcept{
+            for (std::size_t i = 0; i < rows; ++i){
+                for (std::size_t j = 0; j < columns; ++j){
+                    cells(i, j).clear();
+                }
+            }
+
+            slots.clear();
+        }
+
+        /**
+         * @brief Update body's cells and cached bounds when its bounds are changed.
+         *
+         * Only the cells that the body leaves or enters are touched, so a body moving within its cells costs O(1).
+         *
+         * @param handle Handle of body to update.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        void updateBodyCells(BodyHandle handle){
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("ExtentGrid::updateBodyCells: invalid handle");
+            }
+#endif
+            auto &slot = slots[handle.index];
+            slot.bounds = toBounds(BoundsGetter()(storage.get(slot.body)));
+
+            const auto range = getCellRange(slot.bounds);
+            if (range != slot.range){
+                eraseFromCells(handle.index, slot.range, &range);
+                insertIntoCells(handle.index, range, &slot.range);
+                slot.range = range;
+            }
+        }
+
+        /**
+         * @brief Get bodies in grid whose bounds overlap \p rect, including touching ones.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @return A vector of all bodies overlapping \p rect, each of which appears once.
+         */
+        std::vector<body_ref_t> queryRect(const Rect<T> &rect) const{
+            std::vector<body_ref_t> result;
+            visitOverlaps(toBounds(rect), std::numeric_limits<index_t>::max(), [&](index_t slot_index){
+                result.push_back(slots[slot_index].body);
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid whose bounds overlap \p rect, including touching ones. It does
+         * not allocate memory.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @param visitor Function to be invoked with reference of each body overlapping \p rect.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryRect(const Rect<T> &rect, Visitor &&visitor) const{
+            visitOverlaps(toBounds(rect), std::numeric_limits<index_t>::max(), [&](index_t slot_index){
+                visitor(storage.get(slots[slot_index].body));
+            });
+        }
+
+        /**
+         * @brief Get bodies in grid whose bounds overlap bounds of body of \p handle, except the body itself.
+         *
+         * Bounds of the body are taken from the grid, as of its last \p addBody or \p updateBodyCells.
+         *
+         * @param handle Handle of body to query.
+         * @return A vector of all bodies overlapping the body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::vector<body_ref_t> queryOverlap(BodyHandle handle) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("ExtentGrid::queryOverlap: invalid handle");
+            }
+#endif
+            std::vector<body_ref_t> result;
+            visitOverlaps(slots[handle.index].bounds, handle.index, [&](index_t slot_index){
+                result.push_back(slots[slot_index].body);
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid whose bounds overlap bounds of body of \p handle, except the
+         * body itself. It does not allocate memory.
+         *
+         * @param handle Handle of body to query.
+         * @param visitor Function to be invoked with reference of each overlapping body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryOverlap(BodyHandle handle, Visitor &&visitor) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("ExtentGrid::queryOverlap: invalid handle");
+            }
+#endif
+            visitOverlaps(slots[handle.index].bounds, handle.index, [&](index_t slot_index){
+                visitor(storage.get(slots[slot_index].body));
+            });
+        }
+
+        /**
+         * @brief Get all body pairs whose bounds overlap, including touching ones.
+         *
+         * @return A vector of body pairs. Each pair appears exactly once, in either order.
+         */
+        std::vector<std::array<body_ref_t, 2>> queryOverlapPair() const{
+            std::vector<std::array<body_ref_t, 2>> result;
+            visitOverlapPairs([&](index_t slot1, index_t slot2){
+                result.push_back({ slots[slot1].body, slots[slot2].body });
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body pair whose bounds overlap, including touching ones.
+         *
+         * Each pair is visited exactly once, in either order. Unlike the overload that returns a vector, it does not
+         * allocate memory nor copy any body reference.
+         *
+         * @param visitor Function to be invoked with references of both bodies of each pair.
+         */
+        template <std::invocable<Body&, Body&> Visitor>
+        void queryOverlapPair(Visitor &&visitor) const{
+            visitOverlapPairs([&](index_t slot1, index_t slot2){
+                visitor(storage.get(slots[slot1].body), storage.get(slots[slot2].body));
+            });
+        }
+    };
+};
+
+#endif //SPATIAL_EXTENT_GRID_HPP
@@ -1,54 +1,789 @@
 #ifndef SPATIAL_GRID_HPP
 #define SPATIAL_GRID_HPP
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
 #include <concepts>
-#include <list>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <ranges>
-#include <unordered_set>
+#include <span>
+#include <utility>
+#include <vector>
 
+#include "body_storage.hpp"
 #include "rect.hpp"
+#include "utils/cell_cover.hpp"
+#include "utils/counting_sort.hpp"
+#include "utils/distance_filter.hpp"
 #include "utils/matrix.hpp"
+#include "utils/parallel.hpp"
+#include "utils/slot_map.hpp"
+#include "utils/space_filling_curve.hpp"
+#include "utils/stat_counter.hpp"
 #include "utils/thrower.hpp"
 #include "utils/macros.hpp"
 
 namespace spatial{
-    template <std::floating_point T, typename Body, typename PositionGetter>
+    /**
+     * @brief How a grid treats the edges of its bound.
+     */
+    enum class GridBoundary{
+        Bounded, // Bodies must be inside bound, and nothing is found across its edges.
+        Periodic, // Bound wraps around like a torus, and distances follow the minimum image convention.
+    };
+
+    /**
+     * @brief Space filling curve that orders cells in \p Grid::getSpatialOrder.
+     */
+    enum class SpatialOrder{
+        Morton, // Z-order, which is cheap to compute but jumps between quadrants.
+        Hilbert, // Consecutive cells are always adjacent.
+    };
+
+    /**
+     * @brief Uniform grid of bodies, with O(1) update of a moved body.
+     *
+     * How the grid refers to bodies is decided by \p Storage. By default bodies are shared by \p std::shared_ptr, but
+     * \p PointerBodyStorage or \p IndexBodyStorage can be used to keep bodies in user owned contiguous storage, so
+     * that adding a body neither allocates a control block nor touches a reference count.
+     *
+     * Distance queries accept any distance. They visit only the cells that intersect the query circle, so one grid can
+     * serve several interaction radii, although cell size close to the most frequent radius is still the fastest.
+     * \p retune picks such a resolution from the observed occupancy, and \p resize rebins all bodies to it in one pass.
+     *
+     * With \p GridBoundary::Periodic, positions are wrapped into bound, and distance queries and pair queries visit
+     * cells across the edges with their positions shifted by the period, so no ghost bodies are needed. Rectangle,
+     * ray and nearest queries do not wrap.
+     *
+     * Cells are stored in row major order by default. With \p utils::MortonLayout or \p utils::TiledLayout as
+     * \p CellLayout, vertically adjacent cells are also close in memory, which can reduce cache and TLB misses of
+     * neighbor scans in large grids. Only cell headers are laid out this way, as bodies of each cell are in their own
+     * arrays, so measure before switching: the index encoding is not free.
+     *
+     * Cell occupancy can always be inspected by \p getOccupancyStats. If \p SPATIAL_ENABLE_STATS is defined, queries and
+     * updates also count visited cells and tested candidates, readable by \p getQueryStats. Otherwise the counting is
+     * compiled out.
+     */
+    template <std::floating_point T, typename Body, typename PositionGetter, BodyStorage<Body> Storage = SharedBodyStorage<Body>,
+              utils::MatrixLayout CellLayout = utils::RowMajorLayout>
     requires std::invocable<PositionGetter, const Body&> &&
              std::is_same_v<std::invoke_result_t<PositionGetter, const Body&>, Vector2<T>>
     class Grid{
+    public:
+        using index_t = std::uint32_t;
+        using body_ref_t = typename Storage::reference_type; // How the grid refers to a body.
+
+        /**
+         * @brief Stable handle of a body in grid, returned by \p addBody.
+         */
+        using BodyHandle = utils::SlotHandle;
+
+        /**
+         * @brief Counters of queries and updates, recorded if \p SPATIAL_ENABLE_STATS is defined.
+         *
+         * Distance, pair and rectangle queries are counted. A candidate is a body (or a body pair, for pair queries)
+         * whose cached position is tested, and it is accepted if it is passed to the visitor. Bodies of cells entirely
+         * inside a queried rectangle are accepted without being tested.
+         */
+        struct QueryStats{
+            std::uint64_t queries = 0;
+            std::uint64_t cells_visited = 0;
+            std::uint64_t candidates_tested = 0;
+            std::uint64_t candidates_accepted = 0;
+            std::uint64_t updates = 0; // Calls of updateBodyCell.
+            std::uint64_t relinks = 0; // Calls of updateBodyCell that moved body to another cell.
+        };
+
+        /**
+         * @brief Distribution of the number of bodies per cell.
+         */
+        struct OccupancyStats{
+            std::size_t max = 0;
+            double mean = 0; // Mean over all cells.
+            double mean_occupied = 0; // Mean over non-empty cells.
+            std::size_t empty_cells = 0;
+            std::size_t p50 = 0; // Median.
+            std::size_t p90 = 0;
+            std::size_t p99 = 0;
+        };
+
+        /**
+         * @brief Body hit by \p raycast, with the distance from the origin of ray to where it is hit.
+         */
+        struct RaycastHit{
+            body_ref_t body;
+            T distance;
+        };
+
     private:
-        using body_ptr_t = std::shared_ptr<Body>;
-        using cell_t = std::list<body_ptr_t>;
+        static constexpr index_t invalid_index = std::numeric_limits<index_t>::max();
+
+        /**
+         * @brief Body with its location in grid. It acts as a back-pointer from a handle to the cell.
+         */
+        struct Slot{
+            body_ref_t body {};
+            index_t cell = invalid_index; // Linear index of cell that body is in, or invalid_index if slot is free.
+            index_t offset = 0; // Offset of body in its cell.
+        };
+
+        /**
+         * @brief Bodies in a cell with their positions cached in structure-of-arrays form, so that neighbor scans
+         * only touch dense arrays instead of dereferencing every candidate body.
+         */
+        struct Cell{
+            std::vector<index_t> slots; // Slot indices of bodies.
+            std::vector<T> xs; // x positions of bodies, captured at addBody and updateBodyCell.
+            std::vector<T> ys; // y positions of bodies, captured at addBody and updateBodyCell.
+
+            [[nodiscard]] std::size_t size() const noexcept { return slots.size(); }
+            [[nodiscard]] bool empty() const noexcept { return slots.empty(); }
+
+            void push(index_t slot, const Vector2<T> &position){
+                slots.push_back(slot);
+                xs.push_back(position.x);
+                ys.push_back(position.y);
+            }
 
-        utils::Matrix<cell_t> cells;
-        std::size_t num_bodies = 0;
+            /**
+             * @brief Remove the \p offset-th body by swapping it with the last one.
+             * @return Slot index of the body moved into \p offset, or \p invalid_index if nothing is moved.
+             */
+            index_t erase(std::size_t offset) noexcept{
+                const auto moved_slot = offset + 1 == slots.size() ? invalid_index : slots.back();
+                slots[offset] = slots.back();
+                xs[offset] = xs.back();
+                ys[offset] = ys.back();
+
+                slots.pop_back();
+                xs.pop_back();
+                ys.pop_back();
+
+                return moved_slot;
+            }
 
-        struct symmetric_pair_hash{
-            constexpr std::size_t operator()(std::span<const body_ptr_t, 2> pair) const noexcept{
-                return std::hash<body_ptr_t>()(pair[0]) ^ std::hash<body_ptr_t>()(pair[1]);
+            void reserve(std::size_t capacity){
+                slots.reserve(capacity);
+                xs.reserve(capacity);
+                ys.reserve(capacity);
+            }
+
+            void clear() noexcept{
+                slots.clear();
+                xs.clear();
+                ys.clear();
             }
         };
+        using cell_t = Cell;
+
+        Storage storage;
+        std::size_t rows; // Number of rows, which is changed by resize.
+        std::size_t columns; // Number of columns, which is changed by resize.
+        utils::Matrix<cell_t, CellLayout> cells;
+        utils::SlotMap<Slot> slots;
+
+#ifdef SPATIAL_ENABLE_STATS
+        mutable utils::StatCounter stat_queries;
+        mutable utils::StatCounter stat_cells_visited;
+        mutable utils::StatCounter stat_candidates_tested;
+        mutable utils::StatCounter stat_candidates_accepted;
+        utils::StatCounter stat_updates;
+        utils::StatCounter stat_relinks;
 
-        struct symmetric_pair_equal{
-            constexpr bool operator()(std::span<const body_ptr_t, 2> pair1, std::span<const body_ptr_t, 2> pair2) const noexcept{
-                return (pair1[0] == pair2[0] && pair1[1] == pair2[1]) || (pair1[0] == pair2[1] && pair1[1] == pair2[0]);
+        /**
+         * @brief Counters of a running query, which are added to the counters of grid when it ends.
+         */
+        struct QueryStatsScope{
+            const Grid &grid;
+            QueryStats stats;
+
+            explicit QueryStatsScope(const Grid &grid, std::uint64_t queries = 1) noexcept : grid(grid), stats { .queries = queries } {}
+            ~QueryStatsScope(){
+                grid.stat_queries.add(stats.queries);
+                grid.stat_cells_visited.add(stats.cells_visited);
+                grid.stat_candidates_tested.add(stats.candidates_tested);
+                grid.stat_candidates_accepted.add(stats.candidates_accepted);
             }
         };
+#endif
+
+        // Scratch buffers of assign and resize.
+        std::vector<index_t> assign_cells;
+        std::vector<index_t> assign_cell_offsets;
+        std::vector<index_t> assign_order;
+        utils::CountingSortBuffers assign_sort_buffers;
+        std::vector<T> resize_xs;
+        std::vector<T> resize_ys;
+
+        cell_t &getCell(index_t cell_index) noexcept{
+            return cells(cell_index / columns, cell_index % columns);
+        }
+
+        const cell_t &getCell(index_t cell_index) const noexcept{
+            return cells(cell_index / columns, cell_index % columns);
+        }
+
+        index_t getLinearCellIndex(const Vector2<T> &position) const NOEXCEPT_IF_RELEASE{
+            const auto [row, col] = getCellIndex(position);
+            return static_cast<index_t>(row * columns + col);
+        }
+
+        /**
+         * @brief Get the cell that the image cell at \p index is of in a periodic grid, and by how many periods the image
+         * is shifted from it.
+         */
+        static std::pair<std::size_t, std::ptrdiff_t> wrapCellIndex(std::ptrdiff_t index, std::size_t count) noexcept{
+            const auto signed_count = static_cast<std::ptrdiff_t>(count);
+            if (index >= 0 && index < signed_count){
+                return { static_cast<std::size_t>(index), 0 };
+            }
+
+            auto period = index / signed_count;
+            auto wrapped = index % signed_count;
+            if (wrapped < 0){
+                wrapped += signed_count;
+                --period;
+            }
+            return { static_cast<std::size_t>(wrapped), period };
+        }
+
+#ifndef NDEBUG
+        /**
+         * @brief Throw if \p distance can reach two images of the same body in a periodic grid.
+         */
+        void checkPeriodicDistance(T distance, const char *message) const{
+            if (boundary == GridBoundary::Periodic && 2 * distance >= std::min(bound.size.x, bound.size.y)){
+                utils::throwInvalidArgument(message);
+            }
+        }
+#endif
+
+        /**
+         * @brief Put body of \p slot_index into cell at \p cell_index.
+         */
+        void insertIntoCell(index_t slot_index, index_t cell_index, const Vector2<T> &position){
+            auto &cell = getCell(cell_index);
+            slots[slot_index].cell = cell_index;
+            slots[slot_index].offset = static_cast<index_t>(cell.size());
+            cell.push(slot_index, position);
+        }
+
+        /**
+         * @brief Take body of \p slot_index out of its cell in O(1), fixing the offset of the body moved into its place.
+         */
+        void eraseFromCell(index_t slot_index) noexcept{
+            const auto &slot = slots[slot_index];
+            const auto moved_slot = getCell(slot.cell).erase(slot.offset);
+            if (moved_slot != invalid_index){
+                slots[moved_slot].offset = slot.offset;
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with reference of each body except \p body that distance from \p body_position is less
+         * than \p distance.
+         */
+        template <typename F>
+        void visitNearbyBodies(const Body *body, const Vector2<T> &body_position, T distance, F &&func) const{
+#ifndef NDEBUG
+            checkPeriodicDistance(distance, "Grid::queryDistance: distance must be less than half of bound size in periodic grid");
+#endif
+            SPATIAL_STATS(QueryStatsScope query_stats { *this };)
+            const auto distance_square = distance * distance;
+
+            // Visit bodies of a cell that are nearby (center_x, center_y), testing only its cached positions.
+            const auto visit_nearby_bodies = [&](const cell_t &cell, T center_x, T center_y){
+                SPATIAL_STATS(++query_stats.stats.cells_visited; query_stats.stats.candidates_tested += cell.size();)
+                utils::forEachWithinDistance(std::span { cell.xs }, std::span { cell.ys }, center_x, center_y, distance_square, [&](std::size_t index){
+                    const auto &other = slots[cell.slots[index]].body;
+                    if (&storage.get(other) != body){ // except body itself
+                        SPATIAL_STATS(++query_stats.stats.candidates_accepted;)
+                        func(other);
+                    }
+                });
+            };
+
+            if (boundary == GridBoundary::Periodic){
+                // Bodies of an image cell are shifted by its periods, which is the same as shifting the center back.
+                const auto position = wrapPosition(body_position);
+                utils::forEachCoveringRowUnclipped(cellSize(), position - bound.position, distance, [&](std::ptrdiff_t row, std::ptrdiff_t col_begin, std::ptrdiff_t col_end){
+                    const auto [wrapped_row, row_period] = wrapCellIndex(row, rows);
+                    const auto center_y = position.y - static_cast<T>(row_period) * bound.size.y;
+                    for (auto col = col_begin; col < col_end; ++col){
+                        const auto [wrapped_col, col_period] = wrapCellIndex(col, columns);
+                        visit_nearby_bodies(cells(wrapped_row, wrapped_col), position.x - static_cast<T>(col_period) * bound.size.x, center_y);
+                    }
+                });
+                return;
+            }
+
+            // Visit only cells that intersect the circle, so large distance does not scan its bounding square.
+            utils::forEachCoveringRow(bound, rows, columns, body_position, distance, [&](std::size_t row, std::size_t col_begin, std::size_t col_end){
+                for (auto col = col_begin; col < col_end; ++col){
+                    visit_nearby_bodies(cells(row, col), body_position.x, body_position.y);
+                }
+            });
+        }
+
+        /**
+         * @brief Invoke \p func with reference of each body that distance from body of \p handle is less than \p distance.
+         */
+        template <typename F>
+        void visitNearbyBodies(BodyHandle handle, T distance, F &&func) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("Grid::queryDistance: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            const auto &cell = getCell(slot.cell);
+            const auto position = Vector2<T> { cell.xs[slot.offset], cell.ys[slot.offset] };
+            visitNearbyBodies(&storage.get(slot.body), position, distance, func);
+        }
+
+        /**
+         * @brief Invoke \p func with reference of each body inside \p rect.
+         *
+         * Only cells covered by \p rect are visited. Bodies of cells that are strictly inside the covered cell range
+         * are inside \p rect by their cell index, so only the cells on its boundary test the cached positions.
+         */
+        template <typename F>
+        void visitBodiesInRect(const Rect<T> &rect, F &&func) const{
+            SPATIAL_STATS(QueryStatsScope query_stats { *this };)
+
+            // Sides of rect in cell units.
+            const auto cell_size = cellSize();
+            const auto left = (rect.left() - bound.left()) / cell_size.x;
+            const auto top = (rect.top() - bound.top()) / cell_size.y;
+            const auto right = (rect.right() - bound.left()) / cell_size.x;
+            const auto bottom = (rect.bottom() - bound.top()) / cell_size.y;
+            if (right < 0 || bottom < 0 || left > static_cast<T>(columns) || top > static_cast<T>(rows)){
+                return;
+            }
+
+            const auto to_index = [](T value, std::size_t count){
+                return static_cast<std::size_t>(std::clamp(std::floor(value), T { 0 }, static_cast<T>(count - 1)));
+            };
+            const auto row_first = to_index(top, rows);
+            const auto row_last = to_index(bottom, rows);
+            const auto col_first = to_index(left, columns);
+            const auto col_last = to_index(right, columns);
+
+            for (auto row = row_first; row <= row_last; ++row){
+                // Body in a row other than the first and the last covered ones is inside rect vertically, and so are
+                // bodies of the first or the last row when rect extends beyond the grid on that side.
+                const auto row_inside = (row > row_first || top <= 0) && (row < row_last || bottom >= static_cast<T>(rows));
+                for (auto col = col_first; col <= col_last; ++col){
+                    const auto &cell = cells(row, col);
+                    SPATIAL_STATS(++query_stats.stats.cells_visited;)
+                    if (row_inside && (col > col_first || left <= 0) && (col < col_last || right >= static_cast<T>(columns))){
+                        SPATIAL_STATS(query_stats.stats.candidates_accepted += cell.size();)
+                        for (auto slot_index : cell.slots){
+                            func(slots[slot_index].body);
+                        }
+                    }
+                    else{
+                        SPATIAL_STATS(query_stats.stats.candidates_tested += cell.size();)
+                        for (std::size_t i = 0; i < cell.size(); ++i){
+                            if (rect.contains(Vector2<T> { cell.xs[i], cell.ys[i] })){
+                                SPATIAL_STATS(++query_stats.stats.candidates_accepted;)
+                                func(slots[cell.slots[i]].body);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with slot index of each body of \p radius hit by ray and the distance where it is hit,
+         * until \p stop returns true.
+         *
+         * Cells along ray are walked by DDA (Amanatides-Woo) traversal, and bodies in cells within \p radius of each of
+         * them are tested. Since the walked cells are monotone in both axes, only the strip of cells newly entering the
+         * neighborhood is tested at each step, so each cell is tested at most once. \p stop is invoked with the distance
+         * where ray enters the next cell, before its neighborhood is tested.
+         */
+        template <typename Stop, typename F>
+        void visitRayHits(const Vector2<T> &origin, const Vector2<T> &direction, T max_distance, T radius, Stop &&stop, F &&func) const{
+#ifndef NDEBUG
+            if (direction.x == 0 && direction.y == 0){
+                utils::throwInvalidArgument("Grid::raycast: direction must not be zero");
+            }
+#endif
+            const auto unit_direction = direction * (T { 1 } / std::hypot(direction.x, direction.y));
+            const auto relative_origin = origin - bound.position;
+            const auto cell_size = cellSize();
+            const auto radius_square = radius * radius;
+
+            // Clip ray to bound inflated by radius, as bodies near the border can be hit from outside of it.
+            auto t_first = T { 0 };
+            auto t_last = max_distance;
+            for (auto [o, d, size] : { std::array { relative_origin.x, unit_direction.x, bound.size.x }, std::array { relative_origin.y, unit_direction.y, bound.size.y } }){
+                if (d == 0){
+                    if (o < -radius || o > size + radius){
+                        return;
+                    }
+                    continue;
+                }
+
+                auto t1 = (-radius - o) / d;
+                auto t2 = (size + radius - o) / d;
+                if (t1 > t2){
+                    std::swap(t1, t2);
+                }
+                t_first = std::max(t_first, t1);
+                t_last = std::min(t_last, t2);
+            }
+            if (t_first > t_last){
+                return;
+            }
+
+            // Cells are indexed by signed integers, as ray may walk cells out of bound within radius from the border.
+            const auto reach_col = static_cast<std::ptrdiff_t>(std::ceil(radius / cell_size.x));
+            const auto reach_row = static_cast<std::ptrdiff_t>(std::ceil(radius / cell_size.y));
+            const auto to_index = [](T value, std::ptrdiff_t reach, std::size_t count){
+                return static_cast<std::ptrdiff_t>(std::clamp(std::floor(value), static_cast<T>(-reach), static_cast<T>(static_cast<std::ptrdiff_t>(count) + reach - 1)));
+            };
+            const auto start = relative_origin + unit_direction * t_first;
+            auto col = to_index(start.x / cell_size.x, reach_col, columns);
+            auto row = to_index(start.y / cell_size.y, reach_row, rows);
+
+            const auto test_cells = [&](std::ptrdiff_t row_first, std::ptrdiff_t row_last, std::ptrdiff_t col_first, std::ptrdiff_t col_last){
+                row_first = std::max<std::ptrdiff_t>(row_first, 0);
+                row_last = std::min<std::ptrdiff_t>(row_last, static_cast<std::ptrdiff_t>(rows) - 1);
+                col_first = std::max<std::ptrdiff_t>(col_first, 0);
+                col_last = std::min<std::ptrdiff_t>(col_last, static_cast<std::ptrdiff_t>(columns) - 1);
+                for (auto r = row_first; r <= row_last; ++r){
+                    for (auto c = col_first; c <= col_last; ++c){
+                        const auto &cell = cells(r, c);
+                        for (std::size_t i = 0; i < cell.size(); ++i){
+                            const auto to_body = Vector2<T> { cell.xs[i], cell.ys[i] } - origin;
+                            const auto projection = to_body.dot(unit_direction);
+                            const auto perpendicular_square = to_body.dot(to_body) - projection * projection;
+                            if (perpendicular_square > radius_square){
+                                continue;
+                            }
+
+                            auto t = projection - std::sqrt(radius_square - perpendicular_square);
+                            if (t < 0){
+                                if (to_body.dot(to_body) > radius_square){
+                                    continue; // Behind origin.
+                                }
+                                t = 0; // Origin is inside body.
+                            }
+                            if (t <= max_distance){
+                                func(cell.slots[i], t);
+                            }
+                        }
+                    }
+                }
+            };
+
+            const auto step_col = unit_direction.x > 0 ? 1 : -1;
+            const auto step_row = unit_direction.y > 0 ? 1 : -1;
+            const auto next_boundary = [](std::ptrdiff_t index, int step, T cell_length, T o, T d){
+                if (d == 0){
+                    return std::numeric_limits<T>::infinity();
+                }
+                return (static_cast<T>(step > 0 ? index + 1 : index) * cell_length - o) / d;
+            };
+            auto t_next_col = next_boundary(col, step_col, cell_size.x, relative_origin.x, unit_direction.x);
+            auto t_next_row = next_boundary(row, step_row, cell_size.y, relative_origin.y, unit_direction.y);
+            const auto t_delta_col = cell_size.x / std::abs(unit_direction.x);
+            const auto t_delta_row = cell_size.y / std::abs(unit_direction.y);
+
+            if (stop(t_first)){
+                return;
+            }
+            test_cells(row - reach_row, row + reach_row, col - reach_col, col + reach_col);
+            while (true){
+                const auto step_horizontally = t_next_col < t_next_row;
+                const auto t_enter = step_horizontally ? t_next_col : t_next_row;
+                if (t_enter > t_last || stop(t_enter)){
+                    return;
+                }
+
+                if (step_horizontally){
+                    t_next_col += t_delta_col;
+                    col += step_col;
+
+                    // A new column enters the neighborhood.
+                    const auto new_col = col + step_col * reach_col;
+                    test_cells(row - reach_row, row + reach_row, new_col, new_col);
+                }
+                else{
+                    t_next_row += t_delta_row;
+                    row += step_row;
+
+                    const auto new_row = row + step_row * reach_row;
+                    test_cells(new_row, new_row, col - reach_col, col + reach_col);
+                }
+            }
+        }
+
+        /**
+         * @brief Get references of \p k bodies nearest to \p position except the body of \p excluded_slot, in ascending
+         * order of distance.
+         *
+         * Cells are searched ring by ring outward from the cell of \p position, keeping the k nearest bodies found so
+         * far in a max-heap. Search stops when the nearest point of the next ring is not closer than the k-th body.
+         */
+        std::vector<body_ref_t> findNearest(const Vector2<T> &position, std::size_t k, index_t excluded_slot) const{
+            std::vector<body_ref_t> result;
+            if (k == 0){
+                return result;
+            }
+
+            const auto cell_size = cellSize();
+            const auto relative_position = position - bound.position;
+            const auto to_index = [](T value, std::size_t count){
+                return static_cast<std::size_t>(std::clamp(std::floor(value), T { 0 }, static_cast<T>(count - 1)));
+            };
+            const auto center_row = to_index(relative_position.y / cell_size.y, rows);
+            const auto center_col = to_index(relative_position.x / cell_size.x, columns);
+
+            // Max-heap of (square of distance, slot index), whose front is the k-th nearest body found so far.
+            std::vector<std::pair<T, index_t>> heap;
+            heap.reserve(k);
+
+            const auto visit_cell = [&](std::size_t row, std::size_t col){
+                if (heap.size() == k){
+                    // Skip cell if its nearest point is not closer than the k-th nearest body.
+                    const auto cell_left = static_cast<T>(col) * cell_size.x;
+                    const auto cell_top = static_cast<T>(row) * cell_size.y;
+                    const auto dx = std::max({ cell_left - relative_position.x, relative_position.x - (cell_left + cell_size.x), T { 0 } });
+                    const auto dy = std::max({ cell_top - relative_position.y, relative_position.y - (cell_top + cell_size.y), T { 0 } });
+                    if (dx * dx + dy * dy >= heap.front().first){
+                        return;
+                    }
+                }
+
+                const auto &cell = cells(row, col);
+                for (std::size_t i = 0; i < cell.size(); ++i){
+                    if (cell.slots[i] == excluded_slot){
+                        continue;
+                    }
+
+                    const auto candidate = std::pair { position.distance2(Vector2<T> { cell.xs[i], cell.ys[i] }), cell.slots[i] };
+                    if (heap.size() < k){
+                        heap.push_back(candidate);
+                        std::ranges::push_heap(heap);
+                    }
+                    else if (candidate < heap.front()){
+                        std::ranges::pop_heap(heap);
+                        heap.back() = candidate;
+                        std::ranges::push_heap(heap);
+                    }
+                }
+            };
+
+            visit_cell(center_row, center_col);
+            for (std::size_t ring = 1;; ++ring){
+                const auto has_left = center_col >= ring;
+                const auto has_right = center_col + ring < columns;
+                const auto has_top = center_row >= ring;
+                const auto has_bottom = center_row + ring < rows;
+                if (!has_left && !has_right && !has_top && !has_bottom){
+                    break; // All cells are visited.
+                }
+
+                if (heap.size() == k){
+                    // Cells of ring lie outside the square of cells inside it, so their distance is at least the gap
+                    // from position to a side of the square that has cells beyond it.
+                    auto gap = std::numeric_limits<T>::max();
+                    if (has_left){
+                        gap = std::min(gap, relative_position.x - static_cast<T>(center_col - ring + 1) * cell_size.x);
+                    }
+                    if (has_right){
+                        gap = std::min(gap, static_cast<T>(center_col + ring) * cell_size.x - relative_position.x);
+                    }
+                    if (has_top){
+                        gap = std::min(gap, relative_position.y - static_cast<T>(center_row - ring + 1) * cell_size.y);
+                    }
+                    if (has_bottom){
+                        gap = std::min(gap, static_cast<T>(center_row + ring) * cell_size.y - relative_position.y);
+                    }
+                    gap = std::max(gap, T { 0 });
+                    if (gap * gap >= heap.front().first){
+                        break;
+                    }
+                }
+
+                const auto row_first = has_top ? center_row - ring : 0;
+                const auto row_last = has_bottom ? center_row + ring : rows - 1;
+                const auto col_first = has_left ? center_col - ring : 0;
+                const auto col_last = has_right ? center_col + ring : columns - 1;
+
+                // Top and bottom sides of ring.
+                for (auto col = col_first; col <= col_last; ++col){
+                    if (has_top){
+                        visit_cell(center_row - ring, col);
+                    }
+                    if (has_bottom){
+                        visit_cell(center_row + ring, col);
+                    }
+                }
+
+                // Left and right sides of ring, except corners.
+                for (auto row = has_top ? row_first + 1 : row_first; row <= (has_bottom ? row_last - 1 : row_last); ++row){
+                    if (has_left){
+                        visit_cell(row, center_col - ring);
+                    }
+                    if (has_right){
+                        visit_cell(row, center_col + ring);
+                    }
+                }
+            }
+
+            std::ranges::sort_heap(heap);
+            result.reserve(heap.size());
+            for (auto [distance2, slot_index] : heap){
+                result.push_back(slots[slot_index].body);
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p func with slot indices of each body pair that distance between them is less than
+         * \p distance, whose first body is in rows [\p row_begin, \p row_end).
+         */
+        template <typename F>
+        void visitNearbyPairs(T distance, std::size_t row_begin, std::size_t row_end, F &&func) const{
+            // Only the band of the first row counts the query, so that a query split into bands is counted once.
+            SPATIAL_STATS(QueryStatsScope query_stats { *this, row_begin == 0 ? 1U : 0U };)
+            const auto distance_square = distance * distance;
+
+            // Visit pairs of the index-th body of cell and bodies of other cell from first, whose image is shifted by
+            // (shift_x, shift_y).
+            const auto visit_pairs = [&](const cell_t &cell, std::size_t index, const cell_t &other, std::size_t first, T shift_x, T shift_y){
+                const auto xs = std::span { other.xs }.subspan(first);
+                const auto ys = std::span { other.ys }.subspan(first);
+                SPATIAL_STATS(query_stats.stats.candidates_tested += xs.size();)
+                utils::forEachWithinDistance(xs, ys, cell.xs[index] - shift_x, cell.ys[index] - shift_y, distance_square, [&](std::size_t offset){
+                    SPATIAL_STATS(++query_stats.stats.candidates_accepted;)
+                    func(cell.slots[index], other.slots[first + offset]);
+                });
+            };
+
+            /*
+             * +----+----+----+ Left figure is the portion of grid cells when distance is not greater than cell size.
+             * |(1) |(2) |(3) | Each cell (5) is checked against itself, its right cell (6) and its three lower cells
+             * +----+----+----+ (7), (8) and (9). Other adjacent cells, like (1), are not checked because (5) will be
+             * |(4) |(5) |(6) | checked when the current cell is in them. Therefore, every adjacent cell pair is checked
+             * +----+----+----+ exactly once and each body pair is found exactly once, without any deduplication.
+             * |(7) |(8) |(9) |
+             * +----+----+----+ For larger distance, the stencil extends to the right cells and the lower rows within
+             * reach, and cells whose nearest point is farther than distance are skipped.
+             *
+             * In a periodic grid, the stencil wraps across the edges. As distance is less than half of bound size, at
+             * most one image of each body pair is within distance, so pairs are still found exactly once.
+             */
+            const auto cell_size = cellSize();
+            const auto row_reach = utils::rowReach(cell_size, distance, rows);
+            const auto periodic = boundary == GridBoundary::Periodic;
+
+            for (std::size_t row = row_begin; row < row_end; ++row) {
+                for (std::size_t col = 0; col < columns; ++col) {
+                    const auto &cell_current = cells(row, col);
+                    SPATIAL_STATS(++query_stats.stats.cells_visited;)
+                    if (cell_current.empty()){
+                        continue;
+                    }
+
+                    for (std::size_t i = 0; i < cell_current.size(); ++i){
+                        visit_pairs(cell_current, i, cell_current, i + 1, 0, 0);
+                    }
+
+                    for (std::size_t row_offset = 0; row_offset <= row_reach; ++row_offset){
+                        const auto [other_row, row_period] = wrapCellIndex(static_cast<std::ptrdiff_t>(row + row_offset), rows);
+                        if (row_period != 0 && !periodic){
+                            break;
+                        }
+
+                        const auto col_reach = static_cast<std::ptrdiff_t>(utils::columnReach(cell_size, distance, row_offset, columns));
+                        const auto signed_col = static_cast<std::ptrdiff_t>(col);
+                        auto col_first = row_offset == 0 ? signed_col + 1 : signed_col - col_reach;
+                        auto col_last = signed_col + col_reach + 1;
+                        if (!periodic){
+                            col_first = std::max<std::ptrdiff_t>(col_first, 0);
+                            col_last = std::min(col_last, static_cast<std::ptrdiff_t>(columns));
+                        }
+
+                        const auto shift_y = static_cast<T>(row_period) * bound.size.y;
+                        for (auto other_col = col_first; other_col < col_last; ++other_col){
+                            const auto [wrapped_col, col_period] = wrapCellIndex(other_col, columns);
+                            const auto &cell_other = cells(other_row, wrapped_col);
+                            const auto shift_x = static_cast<T>(col_period) * bound.size.x;
+                            SPATIAL_STATS(++query_stats.stats.cells_visited;)
+                            for (std::size_t i = 0; i < cell_current.size(); ++i){
+                                visit_pairs(cell_current, i, cell_other, 0, shift_x, shift_y);
+                            }
+                        }
+                    }
+                }
+            }
+        }
 
     public:
         const Rect<T> bound;
-        const std::size_t rows;
-        const std::size_t columns;
+        const GridBoundary boundary;
 
-        Grid(const Rect<T> &bound, std::size_t rows, std::size_t columns) : bound(bound), rows(rows), columns(columns), cells(rows, columns) {
+        /**
+         * @param bound Bound of grid.
+         * @param rows Number of rows.
+         * @param columns Number of columns.
+         * @param storage Storage policy that resolves body references.
+         * @param boundary How the edges of \p bound are treated.
+         * @throw std::invalid_argument If \p rows or \p columns is 0 in debug mode.
+         */
+        Grid(const Rect<T> &bound, std::size_t rows, std::size_t columns, const Storage &storage = {}, GridBoundary boundary = GridBoundary::Bounded)
+                : storage(storage), rows(rows), columns(columns), cells(rows, columns), bound(bound), boundary(boundary) {
 #ifndef NDEBUG
             if (rows == 0 || columns == 0) {
                 utils::throwInvalidArgument("Grid::Grid: rows and columns must be greater than 0");
             }
 #endif
         }
+
+        /**
+         * @brief Construct grid with \p boundary, which is usually specified without a storage.
+         *
+         * @param bound Bound of grid.
+         * @param rows Number of rows.
+         * @param columns Number of columns.
+         * @param boundary How the edges of \p bound are treated.
+         * @param storage Storage policy that resolves body references.
+         * @throw std::invalid_argument If \p rows or \p columns is 0 in debug mode.
+         */
+        Grid(const Rect<T> &bound, std::size_t rows, std::size_t columns, GridBoundary boundary, const Storage &storage = {})
+                : Grid(bound, rows, columns, storage, boundary) { }
         Grid(Grid&&) noexcept = default;
 
+        /**
+         * @brief Get number of rows.
+         * @return Number of rows.
+         */
+        [[nodiscard]] std::size_t getRowCount() const noexcept{
+            return rows;
+        }
+
+        /**
+         * @brief Get number of columns.
+         * @return Number of columns.
+         */
+        [[nodiscard]] std::size_t getColumnCount() const noexcept{
+            return columns;
+        }
+
         /**
          * @brief Get cell size of grid.
          *
@@ -59,18 +794,41 @@ namespace spatial{
         }
 
         /**
-         * @brief Get cell index of body.
+         * @brief Wrap \p position into bound in periodic grid.
          *
-         * @param body body to get cell index.
+         * @param position Position to wrap.
+         * @return Image of \p position inside bound, or \p position itself if grid is not periodic.
+         */
+        Vector2<T> wrapPosition(const Vector2<T> &position) const noexcept{
+            if (boundary != GridBoundary::Periodic){
+                return position;
+            }
+
+            const auto wrap = [](T value, T period){
+                value -= std::floor(value / period) * period;
+                return value < period ? value : T { 0 }; // Tiny negative value may be rounded up to period.
+            };
+            return bound.position + Vector2<T> { wrap(position.x - bound.position.x, bound.size.x), wrap(position.y - bound.position.y, bound.size.y) };
+        }
+
+        /**
+         * @brief Get cell index of position. In periodic grid, \p position is wrapped into bound first.
+         *
+         * @param position Position to get cell index.
          * @return Cell index in std::array form (row, col).
-         * @throw std::out_of_range If \p body is out of bound in debug mode.
+         * @throw std::out_of_range If \p position is out of bound in debug mode.
          */
-        std::array<std::size_t, 2> getCellIndex(const Body &body) const NOEXCEPT_IF_RELEASE{
-            const auto relative_position = PositionGetter()(body) - bound.position;
+        std::array<std::size_t, 2> getCellIndex(const Vector2<T> &position) const NOEXCEPT_IF_RELEASE{
+            const auto relative_position = wrapPosition(position) - bound.position;
             const auto cell_size = cellSize();
 
-            const auto row = static_cast<std::size_t>(relative_position.y / cell_size.y);
-            const auto col = static_cast<std::size_t>(relative_position.x / cell_size.x);
+            auto row = static_cast<std::size_t>(relative_position.y / cell_size.y);
+            auto col = static_cast<std::size_t>(relative_position.x / cell_size.x);
+            if (boundary == GridBoundary::Periodic){
+                // Division may round a position just below the far edge up to the next cell.
+                row = std::min(row, rows - 1);
+                col = std::min(col, columns - 1);
+            }
 
 #ifndef NDEBUG
             if (row >= rows || col >= columns) {
@@ -81,14 +839,44 @@ namespace spatial{
         }
 
         /**
-         * @brief Get cell that body is in.
+         * @brief Get cell index of body.
+         *
+         * @param body body to get cell index.
+         * @return Cell index in std::array form (row, col).
+         * @throw std::out_of_range If \p body is out of bound in debug mode.
+         */
+        std::array<std::size_t, 2> getCellIndex(const Body &body) const NOEXCEPT_IF_RELEASE{
+            return getCellIndex(PositionGetter()(body));
+        }
+
+        /**
+         * @brief Get cell index that body of \p handle was put at its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body.
+         * @return Cell index in std::array form (row, col).
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::array<std::size_t, 2> getCellIndex(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("Grid::getCellIndex: invalid handle");
+            }
+#endif
+            const auto cell_index = slots[handle.index].cell;
+            return { cell_index / columns, cell_index % columns };
+        }
+
+        /**
+         * @brief Get bodies in a cell.
          *
-         * @param body Body to get cell.
-         * @return Cell that body is in.
+         * @param row Row of the cell.
+         * @param col Column of the cell.
+         * @return View of references of bodies in the cell.
          */
-        cell_t &getBodyCell(const Body &body) NOEXCEPT_IF_RELEASE{
-            const auto [row, col] = getCellIndex(body);
-            return cells(row, col);
+        auto getCellBodies(std::size_t row, std::size_t col) const noexcept{
+            return cells(row, col).slots | std::views::transform([this](index_t slot) -> Body& {
+                return storage.get(slots[slot].body);
+            });
         }
 
         /**
@@ -96,212 +884,750 @@ namespace spatial{
          * @return Number of bodies in grid.
          */
         [[nodiscard]] std::size_t getBodyCount() const noexcept{
-            return num_bodies;
+            return slots.size();
+        }
+
+        /**
+         * @brief Get histogram of the number of bodies per cell.
+         *
+         * @return A vector whose k-th element is the number of cells holding k bodies. Its size is the maximum
+         * occupancy + 1.
+         */
+        std::vector<std::size_t> getOccupancyHistogram() const{
+            std::vector<std::size_t> histogram(1);
+            for (std::size_t row = 0; row < rows; ++row){
+                for (std::size_t col = 0; col < columns; ++col){
+                    const auto size = cells(row, col).size();
+                    if (size >= histogram.size()){
+                        histogram.resize(size + 1);
+                    }
+                    ++histogram[size];
+                }
+            }
+            return histogram;
+        }
+
+        /**
+         * @brief Get distribution of the number of bodies per cell. A large maximum or 99th percentile relative to the
+         * mean of occupied cells means bodies are clustered, and a large share of empty cells means cells are too small.
+         *
+         * @return Occupancy statistics of cells.
+         */
+        OccupancyStats getOccupancyStats() const{
+            const auto histogram = getOccupancyHistogram();
+            const auto cell_count = rows * columns;
+
+            OccupancyStats stats;
+            stats.max = histogram.size() - 1;
+            stats.mean = static_cast<double>(slots.size()) / static_cast<double>(cell_count);
+            stats.empty_cells = histogram[0];
+            if (stats.empty_cells < cell_count){
+                stats.mean_occupied = static_cast<double>(slots.size()) / static_cast<double>(cell_count - stats.empty_cells);
+            }
+
+            // The p-th percentile is the smallest occupancy that at least p percent of cells do not exceed.
+            const auto percentile = [&](std::size_t percent){
+                const auto rank = (cell_count * percent + 99) / 100;
+                std::size_t accumulated = 0;
+                for (std::size_t occupancy = 0; occupancy < histogram.size(); ++occupancy){
+                    accumulated += histogram[occupancy];
+                    if (accumulated >= rank){
+                        return occupancy;
+                    }
+                }
+                return stats.max;
+            };
+            stats.p50 = percentile(50);
+            stats.p90 = percentile(90);
+            stats.p99 = percentile(99);
+
+            return stats;
+        }
+
+        /**
+         * @brief Get references of all bodies sorted by their cells along a space filling curve, in O(cells log cells).
+         *
+         * Bodies in the same cell are in the order of the cell. Reordering user arrays by the result makes per-body loops
+         * and neighbor queries access memory in spatial order. With \p IndexBodyStorage, the result is the permutation to
+         * apply, i.e. the k-th body of the reordered array is the body at index result[k], which
+         * \p utils::applyPermutation of <spatial/utils/permutation.hpp> does, e.g.
+         * \code
+         * const auto order = grid.getSpatialOrder();
+         * utils::applyPermutation(order, positions, velocities);
+         * grid.assign(std::views::iota(0U, static_cast<unsigned>(order.size())));
+         * \endcode
+         *
+         * @param curve Space filling curve to order cells by.
+         * @return Vector of body references, whose size is the number of bodies.
+         */
+        std::vector<body_ref_t> getSpatialOrder(SpatialOrder curve = SpatialOrder::Hilbert) const{
+            const auto order = static_cast<unsigned>(std::bit_width(std::max(rows, columns) - 1));
+            std::vector<std::pair<std::uint64_t, index_t>> keyed_cells;
+            for (std::size_t row = 0; row < rows; ++row){
+                for (std::size_t col = 0; col < columns; ++col){
+                    if (cells(row, col).size() != 0){
+                        const auto key = curve == SpatialOrder::Morton
+                            ? utils::mortonKey(static_cast<std::uint32_t>(row), static_cast<std::uint32_t>(col))
+                            : utils::hilbertKey(order, static_cast<std::uint32_t>(row), static_cast<std::uint32_t>(col));
+                        keyed_cells.emplace_back(key, static_cast<index_t>(row * columns + col));
+                    }
+                }
+            }
+            std::ranges::sort(keyed_cells);
+
+            std::vector<body_ref_t> result;
+            result.reserve(slots.size());
+            for (const auto &[key, cell_index] : keyed_cells){
+                for (const auto slot_index : getCell(cell_index).slots){
+                    result.push_back(slots[slot_index].body);
+                }
+            }
+            return result;
+        }
+
+#ifdef SPATIAL_ENABLE_STATS
+        /**
+         * @brief Get counters of queries and updates since the grid is constructed or \p resetQueryStats is called.
+         *
+         * It is only available if \p SPATIAL_ENABLE_STATS is defined.
+         *
+         * @return Counters of queries and updates.
+         */
+        [[nodiscard]] QueryStats getQueryStats() const noexcept{
+            return {
+                .queries = stat_queries.load(),
+                .cells_visited = stat_cells_visited.load(),
+                .candidates_tested = stat_candidates_tested.load(),
+                .candidates_accepted = stat_candidates_accepted.load(),
+                .updates = stat_updates.load(),
+                .relinks = stat_relinks.load(),
+            };
+        }
+
+        /**
+         * @brief Reset counters of queries and updates to zero. It is only available if \p SPATIAL_ENABLE_STATS is
+         * defined.
+         */
+        void resetQueryStats() noexcept{
+            stat_queries.reset();
+            stat_cells_visited.reset();
+            stat_candidates_tested.reset();
+            stat_candidates_accepted.reset();
+            stat_updates.reset();
+            stat_relinks.reset();
+        }
+#endif
+
+        /**
+         * @brief Check if \p handle refers to a body in grid.
+         *
+         * @param handle Handle to check.
+         * @return true if body of \p handle is not removed, false otherwise.
+         */
+        [[nodiscard]] bool contains(BodyHandle handle) const noexcept{
+            return slots.contains(handle);
+        }
+
+        /**
+         * @brief Get body of \p handle.
+         *
+         * @param handle Handle of body.
+         * @return Reference of body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        Body &getBody(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("Grid::getBody: invalid handle");
+            }
+#endif
+            return storage.get(slots[handle.index].body);
+        }
+
+        /**
+         * @brief Get handle of body in slot \p index. After \p assign, slot i holds the i-th body of the range.
+         *
+         * @param index Slot index.
+         * @return Handle of body in slot.
+         */
+        [[nodiscard]] BodyHandle getBodyHandle(index_t index) const noexcept{
+            return slots.handle(index);
+        }
+
+        /**
+         * @brief Get number of slots. Index of every body handle is less than it.
+         *
+         * @return Number of slots, including free ones.
+         */
+        [[nodiscard]] std::size_t getSlotCount() const noexcept{
+            return slots.slotCount();
         }
 
         /**
          * @brief Add body to grid.
          *
-         * @param body body to add.
-         * @return Reference to cell that body is added.
+         * @param body Reference of body to add, which is convertible to \p body_ref_t.
+         * @return Handle of added body.
          */
-        cell_t &addBody(auto &&body){
-            static_assert(std::is_convertible_v<decltype(body), body_ptr_t>);
+        BodyHandle addBody(auto &&body){
+            static_assert(std::is_convertible_v<decltype(body), body_ref_t>);
 
-            auto &cell = getBodyCell(*body);
-            cell.emplace_back(std::forward<decltype(body)>(body));
+            body_ref_t reference = std::forward<decltype(body)>(body);
+            const auto position = wrapPosition(PositionGetter()(storage.get(reference)));
+            const auto cell_index = getLinearCellIndex(position);
 
-            num_bodies++;
+            const auto handle = slots.insert({ .body = std::move(reference) });
+            insertIntoCell(handle.index, cell_index, position);
 
-            return cell;
+            return handle;
         }
 
         /**
-         * @brief Remove body from grid.
+         * @brief Remove body from grid in O(1).
          *
-         * @param body Body to remove.
-         * @return Number of bodies removed.
+         * @param handle Handle of body to remove. It is invalidated.
+         * @return true if body is removed, false if \p handle was not valid.
          */
-        std::size_t removeBody(const Body &body, cell_t &body_cell) noexcept{
-            auto removed_count = body_cell.remove_if([&body](const auto &ptr){ return ptr.get() == &body; });
-            num_bodies -= removed_count;
+        bool removeBody(BodyHandle handle) noexcept{
+            if (!contains(handle)){
+                return false;
+            }
 
-            return removed_count;
+            eraseFromCell(handle.index);
+            slots.erase(handle);
+
+            return true;
         }
 
         /**
-         * @brief Clear all bodies in grid.
+         * @brief Clear all bodies in grid. All handles are invalidated.
          */
         void clearAllBodies() noexcept{
-            for (auto i = 0; i < rows; ++i){
-                for (auto j = 0; j < columns; ++j){
+            for (std::size_t i = 0; i < rows; ++i){
+                for (std::size_t j = 0; j < columns; ++j){
                     cells(i, j).clear();
                 }
             }
-            num_bodies = 0;
+
+            slots.clear();
         }
 
         /**
-         * @brief Update body's cell when its position is changed.
+         * @brief Replace all bodies in grid with \p bodies.
+         *
+         * Instead of adding bodies one by one, bodies are binned by counting sort and each cell is filled in one pass
+         * with its exact size reserved, so it does not allocate once the cells have grown enough. Cell indices,
+         * counting and filling cells are split across \p num_threads threads, and the result does not depend on the
+         * number of threads. When most bodies move every step, calling it each step is cheaper than \p updateBodyCell
+         * per body; with \p IndexBodyStorage, bodies are referred by their indices in a user array.
+         *
+         * All handles issued before are invalidated. The i-th body is put in slot i, so its handle can be obtained by
+         * \p getBodyHandle(i).
          *
-         * @param body Body to update.
-         * @param previous_cell The cell that body was in (can be obtained by \p getBodyCell method before update).
-         * @return New cell which contains the body.
-         * @throw std::out_of_range If \p previous_cell does not contain \p body in debug mode.
+         * @param bodies Random access range of body references.
+         * @param num_threads Number of threads to use.
+         * @throw std::out_of_range If any body is out of bound in debug mode.
          */
-        cell_t &updateBodyCell(const Body &body, cell_t &previous_cell){
-            const auto [row, col] = getCellIndex(body);
-            auto &new_cell = cells(row, col);
+        template <std::ranges::random_access_range R>
+        requires std::convertible_to<std::ranges::range_reference_t<R>, const body_ref_t&>
+        void assign(R &&bodies, std::size_t num_threads = 1){
+            const auto body_count = static_cast<std::size_t>(std::ranges::size(bodies));
+            const auto begin = std::ranges::begin(bodies);
+            const auto cell_count = rows * columns;
 
-            if (&new_cell == &previous_cell) {
-                return new_cell;
+#ifndef NDEBUG
+            // Validate bounds on the calling thread, as exceptions cannot propagate from workers.
+            for (std::size_t i = 0; i < body_count; ++i){
+                getCellIndex(storage.get(begin[i]));
             }
+#endif
+
+            assign_cells.resize(body_count);
+            assign_cell_offsets.resize(cell_count + 1);
+            assign_order.resize(body_count);
+
+            // Bodies take slots [0, body_count), and all old handles are invalidated.
+            slots.reset(body_count);
+
+            utils::parallelFor(body_count, num_threads, [&](std::size_t first, std::size_t last, std::size_t){
+                for (auto i = first; i < last; ++i){
+                    assign_cells[i] = getLinearCellIndex(PositionGetter()(storage.get(begin[i])));
+                }
+            });
+
+            utils::countingSort(assign_cells, assign_cell_offsets, assign_order, assign_sort_buffers, num_threads);
+
+            // Each thread fills its own range of cells.
+            utils::parallelFor(cell_count, num_threads, [&](std::size_t first, std::size_t last, std::size_t){
+                for (auto cell_index = static_cast<index_t>(first); cell_index < last; ++cell_index){
+                    auto &cell = getCell(cell_index);
+                    cell.clear();
 
-            auto ptr = std::find_if(previous_cell.begin(), previous_cell.end(),
-                                    [&](const auto &ptr){ return ptr.get() == &body; });
+                    const auto offset_begin = assign_cell_offsets[cell_index];
+                    const auto offset_end = assign_cell_offsets[cell_index + 1];
+                    cell.reserve(offset_end - offset_begin);
+                    for (auto offset = offset_begin; offset < offset_end; ++offset){
+                        const auto slot_index = assign_order[offset];
+                        slots[slot_index].body = begin[slot_index];
+                        insertIntoCell(slot_index, cell_index, wrapPosition(PositionGetter()(storage.get(slots[slot_index].body))));
+                    }
+                }
+            });
+        }
+
+        /**
+         * @brief Change number of rows and columns of grid, rebinning all bodies in one pass.
+         *
+         * Bodies are binned by counting sort of their cached positions, and each cell is filled with its exact size
+         * reserved. Handles stay valid, but cell indices change.
+         *
+         * @param new_rows New number of rows.
+         * @param new_columns New number of columns.
+         * @throw std::invalid_argument If \p new_rows or \p new_columns is 0 in debug mode.
+         */
+        void resize(std::size_t new_rows, std::size_t new_columns){
 #ifndef NDEBUG
-            if (ptr == previous_cell.end()) {
-                utils::throwOutOfRange("Grid::updateBodyCell: body not found");
+            if (new_rows == 0 || new_columns == 0) {
+                utils::throwInvalidArgument("Grid::resize: rows and columns must be greater than 0");
             }
 #endif
+            if (new_rows == rows && new_columns == columns){
+                return;
+            }
+
+            // Keep cached positions of bodies before their cells are gone. They stay inside bound, which is unchanged.
+            const auto slot_count = slots.slotCount();
+            resize_xs.resize(slot_count);
+            resize_ys.resize(slot_count);
+            for (std::size_t slot_index = 0; slot_index < slot_count; ++slot_index){
+                const auto &slot = slots[slot_index];
+                if (slot.cell != invalid_index){
+                    const auto &cell = getCell(slot.cell);
+                    resize_xs[slot_index] = cell.xs[slot.offset];
+                    resize_ys[slot_index] = cell.ys[slot.offset];
+                }
+            }
 
-            new_cell.splice(new_cell.end(), previous_cell, ptr);
-            return new_cell;
+            rows = new_rows;
+            columns = new_columns;
+            cells = utils::Matrix<cell_t, CellLayout>(rows, columns);
+
+            // Free slots are put in an extra bucket after all cells.
+            const auto cell_count = rows * columns;
+            assign_cells.resize(slot_count);
+            assign_cell_offsets.resize(cell_count + 2);
+            assign_order.resize(slot_count);
+            for (std::size_t slot_index = 0; slot_index < slot_count; ++slot_index){
+                assign_cells[slot_index] = slots[slot_index].cell == invalid_index
+                    ? static_cast<index_t>(cell_count)
+                    : getLinearCellIndex(Vector2<T> { resize_xs[slot_index], resize_ys[slot_index] });
+            }
+            utils::countingSort(assign_cells, assign_cell_offsets, assign_order, assign_sort_buffers);
+
+            for (auto cell_index = static_cast<index_t>(0); cell_index < cell_count; ++cell_index){
+                const auto offset_begin = assign_cell_offsets[cell_index];
+                const auto offset_end = assign_cell_offsets[cell_index + 1];
+                getCell(cell_index).reserve(offset_end - offset_begin);
+                for (auto offset = offset_begin; offset < offset_end; ++offset){
+                    const auto slot_index = assign_order[offset];
+                    insertIntoCell(slot_index, cell_index, Vector2<T> { resize_xs[slot_index], resize_ys[slot_index] });
+                }
+            }
         }
 
         /**
-         * @brief Get bodies in grid that distance from \p body is less than \p distance.
+         * @brief Choose number of rows and columns for current bodies and \p query_radius, and \p resize grid to it.
          *
-         * @param body Body to query.
-         * @param body_cell_index Cell index of \p body.
-         * @param distance Distance to query.
-         * @return A vector of all bodies distance less than \p distance.
-         * @throw std::invalid_argument If \p distance is greater than cell size in debug mode.
+         * Cells are made as small as the density of bodies in occupied cells, so that an occupied cell holds about one
+         * body, but not smaller than \p query_radius, so that a query visits at most 3x3 cells. Cells are also not
+         * made more than 4 times the number of bodies, which bounds memory when few bodies are spread over a large
+         * bound. Nothing is done if the grid is empty or the chosen resolution is within \p tolerance of the current
+         * one, so it can be called periodically without rebinning for small changes of population.
+         *
+         * @param query_radius Most frequent distance of queries.
+         * @param tolerance Relative change of rows and columns below which grid is not resized.
+         * @return Number of rows and columns after tuning, in std::array form (rows, columns).
          */
-        std::vector<std::shared_ptr<Body>> queryDistance(const Body &body, std::array<std::size_t, 2> body_cell_index, T distance){
+        std::array<std::size_t, 2> retune(T query_radius, T tolerance = T { 0.25 }){
+            if (slots.empty()){
+                return { rows, columns };
+            }
+
+            const auto cell_size = cellSize();
+            const auto stats = getOccupancyStats();
+            const auto occupied_density = static_cast<T>(stats.mean_occupied) / (cell_size.x * cell_size.y);
+            const auto min_side = std::sqrt(bound.size.x * bound.size.y / (4 * static_cast<T>(slots.size())));
+            const auto side = std::max({ query_radius, T { 1 } / std::sqrt(occupied_density), min_side });
+
+            const auto to_count = [&](T length){
+                return static_cast<std::size_t>(std::max(std::floor(length / side), T { 1 }));
+            };
+            const auto new_rows = to_count(bound.size.y);
+            const auto new_columns = to_count(bound.size.x);
+
+            const auto within_tolerance = [&](std::size_t count, std::size_t new_count){
+                return std::abs(static_cast<T>(new_count) - static_cast<T>(count)) <= tolerance * static_cast<T>(count);
+            };
+            if (!within_tolerance(rows, new_rows) || !within_tolerance(columns, new_columns)){
+                resize(new_rows, new_columns);
+            }
+
+            return { rows, columns };
+        }
+
+        /**
+         * @brief Update body's cell and cached position when its position is changed, in O(1).
+         *
+         * @param handle Handle of body to update.
+         * @return New cell index of the body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::array<std::size_t, 2> updateBodyCell(BodyHandle handle){
 #ifndef NDEBUG
-            auto [cell_x, cell_y] = cellSize();
-            if (distance > std::min(cell_x, cell_y)){
-                utils::throwInvalidArgument("Only distance smaller than or equal to cell size is supported.");
+            if (!contains(handle)) {
+                utils::throwOutOfRange("Grid::updateBodyCell: invalid handle");
             }
 #endif
+            const auto &slot = slots[handle.index];
+            const auto position = wrapPosition(PositionGetter()(storage.get(slot.body)));
+            const auto cell_index = getLinearCellIndex(position);
 
-            const auto body_position = PositionGetter()(body);
-            const auto distance_square = std::pow(distance, 2);
+            SPATIAL_STATS(stat_updates.add(1);)
+            if (cell_index == slot.cell) {
+                auto &cell = getCell(cell_index);
+                cell.xs[slot.offset] = position.x;
+                cell.ys[slot.offset] = position.y;
+            }
+            else {
+                SPATIAL_STATS(stat_relinks.add(1);)
+                eraseFromCell(handle.index);
+                insertIntoCell(handle.index, cell_index, position);
+            }
 
-            const auto is_nearby = [&](const Body &other){
-                return PositionGetter()(other).distance2(body_position) <= distance_square;
-            };
+            return { cell_index / columns, cell_index % columns };
+        }
 
-            // Result vector.
-            std::vector<std::shared_ptr<Body>> result;
+        /**
+         * @brief Get bodies in grid that distance from \p body is less than \p distance.
+         *
+         * @param body Body to query.
+         * @param distance Distance to query.
+         * @return A vector of all bodies distance less than \p distance.
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        std::vector<body_ref_t> queryDistance(const Body &body, T distance) const{
+            std::vector<body_ref_t> result;
+            visitNearbyBodies(&body, PositionGetter()(body), distance, [&](const body_ref_t &reference){
+                result.push_back(reference);
+            });
 
-            // Find bodies in same cell.
-            auto queried_body_in_same_cell = cells(body_cell_index[0], body_cell_index[1])
-                     | std::views::filter([&](const auto &ptr){
-                         return ptr.get() != &body && // except body itself
-                                is_nearby(*ptr);
-                     });
+            return result;
+        }
 
-            // Insert bodies in same cell to result.
-            result.insert(result.end(), queried_body_in_same_cell.begin(), queried_body_in_same_cell.end());
+        /**
+         * @brief Invoke \p visitor with each body in grid that distance from \p body is less than \p distance.
+         *
+         * Unlike the overload that returns a vector, it does not allocate memory nor copy any body reference.
+         *
+         * @param body Body to query.
+         * @param distance Distance to query.
+         * @param visitor Function to be invoked with reference of each nearby body.
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryDistance(const Body &body, T distance, Visitor &&visitor) const{
+            visitNearbyBodies(&body, PositionGetter()(body), distance, [&](const body_ref_t &reference){
+                visitor(storage.get(reference));
+            });
+        }
 
-            // Find bodies in adjacent cells.
-            constexpr auto adjacent_offsets = std::array<std::array<int, 2>, 8>{ std::array
-                { -1, -1 }, { -1, 0 }, { -1, 1 },
-                { 0, -1 },             {  0, 1 },
-                {  1, -1 }, {  1, 0 }, {  1, 1 }
-            };
+        /**
+         * @brief Get bodies in grid that distance from body of \p handle is less than \p distance.
+         *
+         * Position and cell of the body are taken from the grid, as of its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body to query.
+         * @param distance Distance to query.
+         * @return A vector of all bodies distance less than \p distance.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        std::vector<body_ref_t> queryDistance(BodyHandle handle, T distance) const{
+            std::vector<body_ref_t> result;
+            visitNearbyBodies(handle, distance, [&](const body_ref_t &reference){
+                result.push_back(reference);
+            });
 
-            const auto translate_cell = [&](std::array<int, 2> xy) -> std::array<int, 2>{
-                const auto [center_row, center_column] = body_cell_index;
-                const auto [dx, dy] = xy;
+            return result;
+        }
 
-                return { static_cast<int>(center_row) + dy, static_cast<int>(center_column) + dx };
+        /**
+         * @brief Invoke \p visitor with each body in grid that distance from body of \p handle is less than
+         * \p distance. It does not allocate memory.
+         *
+         * @param handle Handle of body to query.
+         * @param distance Distance to query.
+         * @param visitor Function to be invoked with reference of each nearby body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryDistance(BodyHandle handle, T distance, Visitor &&visitor) const{
+            visitNearbyBodies(handle, distance, [&](const body_ref_t &reference){
+                visitor(storage.get(reference));
+            });
+        }
 
-            };
-            const auto is_cell_within_bound = [&](std::array<int, 2> cell_index){
-                auto [row, column] = cell_index;
-                return row >= 0 && row < rows && column >= 0 && column < columns;
-            };
+        /**
+         * @brief Get bodies in grid inside \p rect, including its boundary.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @return A vector of all bodies inside \p rect.
+         */
+        std::vector<body_ref_t> queryRect(const Rect<T> &rect) const{
+            std::vector<body_ref_t> result;
+            visitBodiesInRect(rect, [&](const body_ref_t &reference){
+                result.push_back(reference);
+            });
 
-            auto queried_body_in_adjacent_cell = adjacent_offsets
-                    | std::views::transform(translate_cell) // adjacent offsets to cell index.
-                    | std::views::filter(is_cell_within_bound) // filter only cells within bound.
-                    | std::views::transform([&](auto &&cell_index) -> cell_t& {
-                        return cells(cell_index[0], cell_index[1]);
-                    }) // transform cell index to cell.
-                    | std::views::transform([&](auto &cell){
-                        return cell | std::views::filter([&](const auto &ptr) { return is_nearby(*ptr); });
-                    }); // for each cell, filter bodies that are nearby.
+            return result;
+        }
 
-            // Insert bodies in adjacent cells to result.
-            for (auto bodies : queried_body_in_adjacent_cell){
-                result.insert(result.end(), bodies.begin(), bodies.end());
+        /**
+         * @brief Invoke \p visitor with each body in grid inside \p rect, including its boundary. It does not allocate
+         * memory.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @param visitor Function to be invoked with reference of each body inside \p rect.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryRect(const Rect<T> &rect, Visitor &&visitor) const{
+            visitBodiesInRect(rect, [&](const body_ref_t &reference){
+                visitor(storage.get(reference));
+            });
+        }
+
+        /**
+         * @brief Get the first body hit by ray, regarding each body as a circle of \p radius.
+         *
+         * Cells are walked along ray from \p origin, and the walk stops at the first cell that the ray enters after
+         * the nearest hit found so far, so the cost is proportional to the number of cells crossed until the hit. For a
+         * segment cast from \p a to \p b, pass \p b - \p a as \p direction and its length as \p max_distance.
+         *
+         * @param origin Origin of ray. It may be out of bound.
+         * @param direction Direction of ray, which does not have to be normalized.
+         * @param max_distance Maximum distance of ray.
+         * @param radius Radius of bodies.
+         * @return The nearest hit, or \p std::nullopt if ray does not hit any body. If \p origin is inside a body, it is
+         * hit at distance 0.
+         * @throw std::invalid_argument If \p direction is zero in debug mode.
+         */
+        std::optional<RaycastHit> raycast(const Vector2<T> &origin, const Vector2<T> &direction, T max_distance, T radius = 0) const{
+            auto nearest_slot = invalid_index;
+            auto nearest_distance = std::numeric_limits<T>::infinity();
+            visitRayHits(origin, direction, max_distance, radius, [&](T t_enter){
+                return nearest_distance <= t_enter;
+            }, [&](index_t slot_index, T distance){
+                if (distance < nearest_distance){
+                    nearest_slot = slot_index;
+                    nearest_distance = distance;
+                }
+            });
+
+            if (nearest_slot == invalid_index){
+                return std::nullopt;
             }
+            return RaycastHit { slots[nearest_slot].body, nearest_distance };
+        }
 
+        /**
+         * @brief Get all bodies hit by ray, regarding each body as a circle of \p radius.
+         *
+         * @param origin Origin of ray. It may be out of bound.
+         * @param direction Direction of ray, which does not have to be normalized.
+         * @param max_distance Maximum distance of ray.
+         * @param radius Radius of bodies.
+         * @return A vector of hits, in ascending order of distance.
+         * @throw std::invalid_argument If \p direction is zero in debug mode.
+         */
+        std::vector<RaycastHit> raycastAll(const Vector2<T> &origin, const Vector2<T> &direction, T max_distance, T radius = 0) const{
+            std::vector<RaycastHit> result;
+            visitRayHits(origin, direction, max_distance, radius, [](T){
+                return false;
+            }, [&](index_t slot_index, T distance){
+                result.push_back({ slots[slot_index].body, distance });
+            });
+
+            std::ranges::stable_sort(result, {}, &RaycastHit::distance);
             return result;
         }
 
+        /**
+         * @brief Get \p k bodies in grid nearest to \p position.
+         *
+         * Cells are searched ring by ring outward from the cell of \p position, and the search stops as soon as the
+         * next ring cannot contain a body nearer than the k-th nearest one, so the cost does not depend on how far the
+         * k-th body is known to be in advance. \p position may be out of bound.
+         *
+         * @param position Position to query.
+         * @param k Number of bodies to find.
+         * @return A vector of min(\p k, body count) bodies, in ascending order of distance.
+         */
+        std::vector<body_ref_t> queryNearest(const Vector2<T> &position, std::size_t k) const{
+            return findNearest(position, k, invalid_index);
+        }
+
+        /**
+         * @brief Get \p k bodies in grid nearest to body of \p handle, except the body itself.
+         *
+         * Position of the body is taken from the grid, as of its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body to query.
+         * @param k Number of bodies to find.
+         * @return A vector of min(\p k, body count - 1) bodies, in ascending order of distance.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::vector<body_ref_t> queryNearest(BodyHandle handle, std::size_t k) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("Grid::queryNearest: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            const auto &cell = getCell(slot.cell);
+            return findNearest(Vector2<T> { cell.xs[slot.offset], cell.ys[slot.offset] }, k, handle.index);
+        }
+
         /**
          * @brief Get all body pairs that distance between them is less than \p distance.
          * @param distance Distance to query.
-         * @return Set of body pairs that distance between them is less than \p distance. It contains unique pairs only,
-         * which means if (body1, body2) is in set, (body2, body1) is not in set.
-         * @throw std::invalid_argument If \p distance is greater than cell size in debug mode.
+         * @return A vector of body pairs that distance between them is less than \p distance. It contains unique pairs
+         * only, which means if (body1, body2) is in vector, (body2, body1) is not in vector.
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
          */
-        std::unordered_set<std::array<body_ptr_t, 2>, symmetric_pair_hash, symmetric_pair_equal> queryDistancePair(T distance){
+        std::vector<std::array<body_ref_t, 2>> queryDistancePair(T distance) const{
 #ifndef NDEBUG
-            auto [cell_x, cell_y] = cellSize();
-            if (distance > std::min(cell_x, cell_y)){
-                utils::throwInvalidArgument("Only distance smaller than or equal to cell size is supported.");
-            }
+            checkPeriodicDistance(distance, "Grid::queryDistancePair: distance must be less than half of bound size in periodic grid");
 #endif
-            const auto is_nearby = [&](const Body &body1, const Body &body2){
-                return PositionGetter()(body1).distance2(PositionGetter()(body2)) <= std::pow(distance, 2);
-            };
+            std::vector<std::array<body_ref_t, 2>> result;
+            visitNearbyPairs(distance, 0, rows, [&](index_t slot1, index_t slot2){
+                result.push_back({ slots[slot1].body, slots[slot2].body });
+            });
 
-            /*
-             * +----+----+----+ Left figure is the portion of grid cells. This algorithm finds collision pair of cell (5)
-             * |(1) |(2) |(3) | in (1) (top-left), (2) (top), (4) (left) and (5) (current). It does not find in other
-             * +----+----+----+ adjacent cells, like (3) because it will be checked by (6). However, if the body pair is
-             * |(4) |(5) |(6) | within edge of (2) and (5), they will be checked twice when current cell is in (6).
-             * +----+----+----+ Therefore, the result should be unordered_set, which only allows unique elements.
-             * |(7) |(8) |(8) | A pair is same if their elements are same, regardless of the order, i.e. (body1, body2)
-             * +----+----+----+ and (body2, body1) are same. Therefore, symmetric_pair_hash and symmetric_pair_equal are used.
-             */
-            std::unordered_set<std::array<body_ptr_t, 2>, symmetric_pair_hash, symmetric_pair_equal> result;
-            for (std::size_t row = 1; row < rows; ++row) {
-                for (std::size_t col = 1; col < columns; col++) {
-                    const auto &cell_current = cells(row, col);
-                    const auto &cell_left = cells(row, col - 1);
-                    const auto &cell_top = cells(row - 1, col);
-                    const auto &cell_top_left = cells(row - 1, col - 1);
+            return result;
+        }
 
-                    auto reserve_size = cell_current.size() + cell_left.size() + cell_top.size() + cell_top_left.size();
-                    if (reserve_size == 0){ // Four cells are all empty
-                        continue;
-                    }
+        /**
+         * @brief Invoke \p visitor with each body pair that distance between them is less than \p distance.
+         *
+         * Each pair is visited exactly once, in either order. Unlike the overload that returns a vector, it does not
+         * allocate memory nor copy any body reference.
+         *
+         * @param distance Distance to query.
+         * @param visitor Function to be invoked with references of both bodies of each pair.
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        template <std::invocable<Body&, Body&> Visitor>
+        void queryDistancePair(T distance, Visitor &&visitor) const{
+#ifndef NDEBUG
+            checkPeriodicDistance(distance, "Grid::queryDistancePair: distance must be less than half of bound size in periodic grid");
+#endif
+            visitNearbyPairs(distance, 0, rows, [&](index_t slot1, index_t slot2){
+                visitor(storage.get(slots[slot1].body), storage.get(slots[slot2].body));
+            });
+        }
 
-                    std::vector<body_ptr_t> check_bodies;
-                    check_bodies.reserve(reserve_size);
-                    check_bodies.insert(check_bodies.end(), cell_current.begin(), cell_current.end());
-                    check_bodies.insert(check_bodies.end(), cell_left.begin(), cell_left.end());
-                    check_bodies.insert(check_bodies.end(), cell_top.begin(), cell_top.end());
-                    check_bodies.insert(check_bodies.end(), cell_top_left.begin(), cell_top_left.end());
-
-                    for (auto i = 0; i < check_bodies.size(); ++i){
-                        for (auto j = i + 1; j < check_bodies.size(); ++j){
-                            if (is_nearby(*check_bodies[i], *check_bodies[j])){
-                                result.emplace(std::array { check_bodies[i], check_bodies[j] });
-                            }
-                        }
-                    }
-                }
+        /**
+         * @brief Invoke \p visitor with handles of each body pair that distance between them is less than \p distance.
+         *
+         * Each pair is visited exactly once, in the same order as \p queryDistancePair(distance). It is useful to build
+         * data indexed by body handles, like neighbor lists.
+         *
+         * @param distance Distance to query.
+         * @param visitor Function to be invoked with handles of both bodies of each pair.
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        template <std::invocable<BodyHandle, BodyHandle> Visitor>
+        void queryDistancePairHandles(T distance, Visitor &&visitor) const{
+#ifndef NDEBUG
+            checkPeriodicDistance(distance, "Grid::queryDistancePairHandles: distance must be less than half of bound size in periodic grid");
+#endif
+            visitNearbyPairs(distance, 0, rows, [&](index_t slot1, index_t slot2){
+                visitor(getBodyHandle(slot1), getBodyHandle(slot2));
+            });
+        }
+
+        /**
+         * @brief Get all body pairs that distance between them is less than \p distance, using multiple threads.
+         *
+         * Grid is split into \p num_threads row bands, and each thread collects pairs of its band into its own buffer.
+         * Buffers are concatenated in band order, so the result is the same as the single threaded overload.
+         *
+         * @param distance Distance to query.
+         * @param num_threads Number of threads to use.
+         * @return A vector of body pairs that distance between them is less than \p distance. It contains unique pairs
+         * only, in the same order as \p queryDistancePair(distance).
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        std::vector<std::array<body_ref_t, 2>> queryDistancePair(T distance, std::size_t num_threads) const{
+#ifndef NDEBUG
+            checkPeriodicDistance(distance, "Grid::queryDistancePair: distance must be less than half of bound size in periodic grid");
+#endif
+            std::vector<std::vector<std::array<body_ref_t, 2>>> thread_results(std::clamp<std::size_t>(num_threads, 1, rows));
+            utils::parallelFor(rows, num_threads, [&](std::size_t row_begin, std::size_t row_end, std::size_t thread_index){
+                auto &thread_result = thread_results[thread_index];
+                visitNearbyPairs(distance, row_begin, row_end, [&](index_t slot1, index_t slot2){
+                    thread_result.push_back({ slots[slot1].body, slots[slot2].body });
+                });
+            });
+
+            std::size_t total_size = 0;
+            for (const auto &thread_result : thread_results){
+                total_size += thread_result.size();
+            }
+
+            std::vector<std::array<body_ref_t, 2>> result;
+            result.reserve(total_size);
+            for (auto &thread_result : thread_results){
+                std::move(thread_result.begin(), thread_result.end(), std::back_inserter(result));
             }
 
             return result;
         }
+
+        /**
+         * @brief Invoke \p visitor with each body pair that distance between them is less than \p distance, using
+         * multiple threads.
+         *
+         * Grid is split into \p num_threads row bands and \p visitor is invoked concurrently from each thread, so it
+         * must be thread-safe. Pairs are consumed in place without being buffered, in unspecified order across threads.
+         *
+         * @param distance Distance to query.
+         * @param num_threads Number of threads to use.
+         * @param visitor Function to be invoked with references of both bodies of each pair and the index of the
+         * invoking thread, which is in [0, \p num_threads).
+         * @throw std::invalid_argument If grid is periodic and \p distance is not less than half of bound size in debug
+         * mode.
+         */
+        template <std::invocable<Body&, Body&, std::size_t> Visitor>
+        void queryDistancePair(T distance, std::size_t num_threads, Visitor &&visitor) const{
+#ifndef NDEBUG
+            checkPeriodicDistance(distance, "Grid::queryDistancePair: distance must be less than half of bound size in periodic grid");
+#endif
+            utils::parallelFor(rows, num_threads, [&](std::size_t row_begin, std::size_t row_end, std::size_t thread_index){
+                visitNearbyPairs(distance, row_begin, row_end, [&](index_t slot1, index_t slot2){
+                    visitor(storage.get(slots[slot1].body), storage.get(slots[slot2].body), thread_index);
+                });
+            });
+        }
     };
 };
 
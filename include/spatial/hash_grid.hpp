@@ -0,0 +1,1019 @@
+#ifndef SPATIAL_HASH_GRID_HPP
+#define SPATIAL_HASH_GRID_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "body_storage.hpp"
+#include "rect.hpp"
+#include "utils/cell_cover.hpp"
+#include "utils/slot_map.hpp"
+#include "utils/thrower.hpp"
+#include "utils/macros.hpp"
+
+namespace spatial{
+    /**
+     * @brief Unbounded sparse grid of bodies, whose cells are hashed by their integer coordinates.
+     *
+     * Only occupied cells are stored, in an open-addressing table with linear probing, so memory scales with the number
+     * of occupied cells instead of the area of the world, and bodies may be anywhere. Each occupied cell keeps slot
+     * indices and cached positions of its bodies in contiguous arrays as in \p Grid, so queries scan dense arrays.
+     * Arrays of emptied cells are pooled and reused, so adding a body to a new cell does not allocate once the pool has
+     * grown, and removing or moving a body is O(1) on average.
+     *
+     * Cell coordinates are 32-bit integers. Positions whose cell coordinates are beyond that range are put in the
+     * border cells of the range, which keeps queries correct but makes those cells crowded. NaN positions are put in
+     * cell (0, 0).
+     */
+    template <std::floating_point T, typename Body, typename PositionGetter, BodyStorage<Body> Storage = SharedBodyStorage<Body>>
+    requires std::invocable<PositionGetter, const Body&> &&
+             std::is_same_v<std::invoke_result_t<PositionGetter, const Body&>, Vector2<T>>
+    class HashGrid{
+    public:
+        using index_t = std::uint32_t;
+        using coord_t = std::int32_t;
+        using body_ref_t = typename Storage::reference_type; // How the grid refers to a body.
+
+        /**
+         * @brief Stable handle of a body in grid, returned by \p addBody.
+         */
+        using BodyHandle = utils::SlotHandle;
+
+        /**
+         * @brief Body hit by \p raycast, with the distance from the origin of ray to where it is hit.
+         */
+        struct RaycastHit{
+            body_ref_t body;
+            T distance;
+        };
+
+    private:
+        static constexpr index_t invalid_index = std::numeric_limits<index_t>::max();
+
+        /**
+         * @brief Body with its location in grid. It acts as a back-pointer from a handle to the cell.
+         */
+        struct Slot{
+            body_ref_t body {};
+            coord_t row = 0; // Cell of body.
+            coord_t col = 0;
+            index_t cell = invalid_index; // Index of cell in the pool.
+            index_t offset = 0; // Offset of body in its cell.
+        };
+
+        /**
+         * @brief Bodies in a cell with their positions cached in structure-of-arrays form.
+         */
+        struct Cell{
+            std::vector<index_t> slots; // Slot indices of bodies.
+            std::vector<T> xs; // x positions of bodies, captured at addBody and updateBodyCell.
+            std::vector<T> ys; // y positions of bodies, captured at addBody and updateBodyCell.
+
+            [[nodiscard]] std::size_t size() const noexcept { return slots.size(); }
+            [[nodiscard]] bool empty() const noexcept { return slots.empty(); }
+
+            void push(index_t slot, const Vector2<T> &position){
+                slots.push_back(slot);
+                xs.push_back(position.x);
+                ys.push_back(position.y);
+            }
+
+            /**
+             * @brief Remove the \p offset-th body by swapping it with the last one.
+             * @return Slot index of the body moved into \p offset, or \p invalid_index if nothing is moved.
+             */
+            index_t erase(std::size_t offset) noexcept{
+                const auto moved_slot = offset + 1 == slots.size() ? invalid_index : slots.back();
+                slots[offset] = slots.back();
+                xs[offset] = xs.back();
+                ys[offset] = ys.back();
+
+                slots.pop_back();
+                xs.pop_back();
+                ys.pop_back();
+
+                return moved_slot;
+            }
+
+            void clear() noexcept{
+                slots.clear();
+                xs.clear();
+                ys.clear();
+            }
+        };
+
+        /**
+         * @brief Occupied cell in the hash table. It is empty if \p cell is \p invalid_index.
+         */
+        struct Entry{
+            coord_t row = 0;
+            coord_t col = 0;
+            index_t cell = invalid_index; // Index of cell in the pool.
+        };
+
+        Storage storage;
+        std::vector<Entry> table; // Its size is zero or a power of two.
+        std::size_t num_cells = 0;
+        std::vector<Cell> cells; // Pool of cells, referred by entries of the table.
+        std::vector<index_t> free_cells; // Cells in the pool that no entry refers to. They are empty.
+        utils::SlotMap<Slot> slots;
+
+        std::size_t home(coord_t row, coord_t col) const noexcept{
+            auto hash = static_cast<std::uint64_t>(static_cast<std::uint32_t>(row)) << 32 | static_cast<std::uint32_t>(col);
+            hash *= 0x9E3779B97F4A7C15ULL;
+            return static_cast<std::size_t>(hash >> 32) & (table.size() - 1);
+        }
+
+        /**
+         * @brief Get table index of cell (\p row, \p col), or the index of the empty entry where it would be put.
+         */
+        std::size_t probe(coord_t row, coord_t col) const noexcept{
+            auto index = home(row, col);
+            while (table[index].cell != invalid_index && (table[index].row != row || table[index].col != col)){
+                index = (index + 1) & (table.size() - 1);
+            }
+            return index;
+        }
+
+        /**
+         * @brief Get cell (\p row, \p col), or nullptr if it is not occupied.
+         */
+        const Cell *findCell(coord_t row, coord_t col) const noexcept{
+            if (num_cells == 0){
+                return nullptr;
+            }
+
+            const auto &entry = table[probe(row, col)];
+            return entry.cell == invalid_index ? nullptr : &cells[entry.cell];
+        }
+
+        /**
+         * @brief Double the table, keeping load factor at most 1/2.
+         */
+        void grow(){
+            auto old_table = std::move(table);
+            table.assign(std::max<std::size_t>(old_table.size() * 2, 16), Entry {});
+            for (const auto &entry : old_table){
+                if (entry.cell != invalid_index){
+                    table[probe(entry.row, entry.col)] = entry;
+                }
+            }
+        }
+
+        /**
+         * @brief Remove the entry at table index \p index, shifting the following entries of its probe sequence back
+         * so that no tombstone is needed. Its cell goes back to the pool.
+         */
+        void eraseEntry(std::size_t index) noexcept{
+            free_cells.push_back(table[index].cell);
+
+            const auto mask = table.size() - 1;
+            for (auto next = (index + 1) & mask; table[next].cell != invalid_index; next = (next + 1) & mask){
+                // Entry at next can fill the hole unless its home is cyclically in (index, next].
+                const auto next_home = home(table[next].row, table[next].col);
+                const auto stays = index < next ? (index < next_home && next_home <= next) : (index < next_home || next_home <= next);
+                if (!stays){
+                    table[index] = table[next];
+                    index = next;
+                }
+            }
+            table[index] = Entry {};
+            --num_cells;
+        }
+
+        /**
+         * @brief Get cell coordinate of \p value in cell units along an axis, clamped to the range of \p coord_t. NaN
+         * is put in coordinate 0.
+         */
+        static coord_t toCoord(T value) noexcept{
+            if (std::isnan(value)){
+                return 0;
+            }
+
+            // Clamp in double, which represents every coord_t exactly, as float cannot represent the maximum of coord_t.
+            return static_cast<coord_t>(std::clamp(static_cast<double>(std::floor(value)),
+                                                   static_cast<double>(std::numeric_limits<coord_t>::min()),
+                                                   static_cast<double>(std::numeric_limits<coord_t>::max())));
+        }
+
+        std::array<coord_t, 2> toCell(T x, T y) const noexcept{
+            const auto cell_size = cellSize();
+            return { toCoord(y / cell_size.y), toCoord(x / cell_size.x) };
+        }
+
+        /**
+         * @brief Put body of \p slot_index at the end of the cell of its row and column, creating the cell if it is
+         * not occupied.
+         */
+        void insertIntoCell(index_t slot_index, const Vector2<T> &position){
+            auto &slot = slots[slot_index];
+            if (table.empty()){
+                grow();
+            }
+
+            // Table grows only when a new cell is created, so that moving into an occupied cell never rehashes.
+            auto index = probe(slot.row, slot.col);
+            if (table[index].cell == invalid_index){
+                if ((num_cells + 1) * 2 > table.size()){
+                    grow();
+                    index = probe(slot.row, slot.col);
+                }
+
+                auto &entry = table[index];
+                entry.row = slot.row;
+                entry.col = slot.col;
+                if (free_cells.empty()){
+                    entry.cell = static_cast<index_t>(cells.size());
+                    cells.emplace_back();
+                }
+                else{
+                    entry.cell = free_cells.back();
+                    free_cells.pop_back();
+                }
+                ++num_cells;
+            }
+
+            auto &cell = cells[table[index].cell];
+            slot.cell = table[index].cell;
+            slot.offset = static_cast<index_t>(cell.size());
+            cell.push(slot_index, position);
+        }
+
+        /**
+         * @brief Remove body of \p slot_index from its cell, removing the cell if it becomes empty.
+         */
+        void eraseFromCell(index_t slot_index) noexcept{
+            const auto &slot = slots[slot_index];
+            auto &cell = cells[slot.cell];
+            const auto moved_slot = cell.erase(slot.offset);
+            if (moved_slot != invalid_index){
+                slots[moved_slot].offset = slot.offset;
+            }
+
+            if (cell.empty()){
+                eraseEntry(probe(slot.row, slot.col));
+            }
+        }
+
+        /**
+         * @brief Get cached position of body of \p slot_index.
+         */
+        Vector2<T> getPosition(index_t slot_index) const noexcept{
+            const auto &slot = slots[slot_index];
+            const auto &cell = cells[slot.cell];
+            return { cell.xs[slot.offset], cell.ys[slot.offset] };
+        }
+
+        /**
+         * @brief Invoke \p func with each occupied cell in rows [\p row_first, \p row_last] and columns [\p col_first,
+         * \p col_last], and its row and column. If the range has more cells than the table has entries, the table is
+         * scanned instead, so the cost is bounded by the smaller of them.
+         */
+        template <typename F>
+        void visitCells(std::int64_t row_first, std::int64_t row_last, std::int64_t col_first, std::int64_t col_last, F &&func) const{
+            // Cells out of the range of coord_t do not exist.
+            constexpr auto coord_min = std::int64_t { std::numeric_limits<coord_t>::min() };
+            constexpr auto coord_max = std::int64_t { std::numeric_limits<coord_t>::max() };
+            row_first = std::max(row_first, coord_min);
+            row_last = std::min(row_last, coord_max);
+            col_first = std::max(col_first, coord_min);
+            col_last = std::min(col_last, coord_max);
+            if (row_first > row_last || col_first > col_last){
+                return;
+            }
+
+            if (static_cast<double>(row_last - row_first + 1) * static_cast<double>(col_last - col_first + 1) > static_cast<double>(table.size())){
+                for (const auto &entry : table){
+                    if (entry.cell != invalid_index && row_first <= entry.row && entry.row <= row_last && col_first <= entry.col && entry.col <= col_last){
+                        func(cells[entry.cell], entry.row, entry.col);
+                    }
+                }
+                return;
+            }
+
+            for (auto row = row_first; row <= row_last; ++row){
+                for (auto col = col_first; col <= col_last; ++col){
+                    if (const auto cell = findCell(static_cast<coord_t>(row), static_cast<coord_t>(col))){
+                        func(*cell, static_cast<coord_t>(row), static_cast<coord_t>(col));
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with slot index of each body except \p excluded_slot that distance from (\p x, \p y) is
+         * less than \p distance.
+         */
+        template <typename F>
+        void visitNearbyBodies(T x, T y, index_t excluded_slot, T distance, F &&func) const{
+            const auto distance_square = distance * distance;
+            const auto [row_first, col_first] = toCell(x - distance, y - distance);
+            const auto [row_last, col_last] = toCell(x + distance, y + distance);
+            visitCells(row_first, row_last, col_first, col_last, [&](const Cell &cell, coord_t, coord_t){
+                for (std::size_t i = 0; i < cell.size(); ++i){
+                    const auto dx = cell.xs[i] - x;
+                    const auto dy = cell.ys[i] - y;
+                    if (cell.slots[i] != excluded_slot && dx * dx + dy * dy <= distance_square){
+                        func(cell.slots[i]);
+                    }
+                }
+            });
+        }
+
+        /**
+         * @brief Invoke \p func with slot indices of each body pair that distance between them is less than
+         * \p distance.
+         *
+         * Each occupied cell is checked against itself and the cells within reach on its right and lower side. They are
+         * gathered by a single \p visitCells over the bounding rectangle of that half neighborhood, so the cost per cell
+         * is bounded by the smaller of the neighborhood and the table. Every pair is found exactly once, as in \p Grid.
+         */
+        template <typename F>
+        void visitNearbyPairs(T distance, F &&func) const{
+            const auto distance_square = distance * distance;
+            const auto cell_size = cellSize();
+            const auto unbounded = static_cast<std::size_t>(std::numeric_limits<coord_t>::max());
+            const auto row_reach = static_cast<std::int64_t>(utils::rowReach(cell_size, distance, unbounded));
+            const auto col_reach = static_cast<std::int64_t>(utils::columnReach(cell_size, distance, 0, unbounded));
+
+            for (const auto &entry : table){
+                if (entry.cell == invalid_index){
+                    continue;
+                }
+
+                const auto &cell = cells[entry.cell];
+                for (std::size_t i = 0; i < cell.size(); ++i){
+                    for (auto j = i + 1; j < cell.size(); ++j){
+                        const auto dx = cell.xs[j] - cell.xs[i];
+                        const auto dy = cell.ys[j] - cell.ys[i];
+                        if (dx * dx + dy * dy <= distance_square){
+                            func(cell.slots[i], cell.slots[j]);
+                        }
+                    }
+                }
+
+                visitCells(entry.row, entry.row + row_reach, entry.col - col_reach, entry.col + col_reach, [&](const Cell &other, coord_t row, coord_t col){
+                    const auto row_offset = static_cast<std::int64_t>(row) - entry.row;
+                    const auto col_offset = static_cast<std::int64_t>(col) - entry.col;
+                    if (row_offset == 0 && col_offset <= 0){
+                        return; // Left side of the same row, or the cell itself.
+                    }
+                    if (std::abs(col_offset) > static_cast<std::int64_t>(utils::columnReach(cell_size, distance, static_cast<std::size_t>(row_offset), unbounded))){
+                        return;
+                    }
+
+                    for (std::size_t i = 0; i < cell.size(); ++i){
+                        for (std::size_t j = 0; j < other.size(); ++j){
+                            const auto dx = other.xs[j] - cell.xs[i];
+                            const auto dy = other.ys[j] - cell.ys[i];
+                            if (dx * dx + dy * dy <= distance_square){
+                                func(cell.slots[i], other.slots[j]);
+                            }
+                        }
+                    }
+                });
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with slot index of each body inside \p rect.
+         */
+        template <typename F>
+        void visitBodiesInRect(const Rect<T> &rect, F &&func) const{
+            const auto [row_first, col_first] = toCell(rect.left(), rect.top());
+            const auto [row_last, col_last] = toCell(rect.right(), rect.bottom());
+            visitCells(row_first, row_last, col_first, col_last, [&](const Cell &cell, coord_t, coord_t){
+                for (std::size_t i = 0; i < cell.size(); ++i){
+                    if (rect.contains(Vector2<T> { cell.xs[i], cell.ys[i] })){
+                        func(cell.slots[i]);
+                    }
+                }
+            });
+        }
+
+        /**
+         * @brief Invoke \p func with slot index of each body of \p radius hit by ray and the distance where it is hit,
+         * until \p stop returns true.
+         *
+         * Cells along ray are walked by DDA (Amanatides-Woo) traversal as in \p Grid, looking up the strip of cells newly
+         * entering the neighborhood of radius at each step. If the walk would look up more cells than the table has
+         * entries, which includes an infinite \p max_distance, every occupied cell is tested instead, ignoring \p stop.
+         */
+        template <typename Stop, typename F>
+        void visitRayHits(const Vector2<T> &origin, const Vector2<T> &direction, T max_distance, T radius, Stop &&stop, F &&func) const{
+#ifndef NDEBUG
+            if (direction.x == 0 && direction.y == 0){
+                utils::throwInvalidArgument("HashGrid::raycast: direction must not be zero");
+            }
+#endif
+            if (num_cells == 0){
+                return;
+            }
+
+            const auto unit_direction = direction * (T { 1 } / std::hypot(direction.x, direction.y));
+            const auto cell_size = cellSize();
+            const auto radius_square = radius * radius;
+
+            const auto test_cell = [&](const Cell &cell, coord_t, coord_t){
+                for (std::size_t i = 0; i < cell.size(); ++i){
+                    const auto to_body = Vector2<T> { cell.xs[i], cell.ys[i] } - origin;
+                    const auto projection = to_body.dot(unit_direction);
+                    const auto perpendicular_square = to_body.dot(to_body) - projection * projection;
+                    if (perpendicular_square > radius_square){
+                        continue;
+                    }
+
+                    auto t = projection - std::sqrt(radius_square - perpendicular_square);
+                    if (t < 0){
+                        if (to_body.dot(to_body) > radius_square){
+                            continue; // Behind origin.
+                        }
+                        t = 0; // Origin is inside body.
+                    }
+                    if (t <= max_distance){
+                        func(cell.slots[i], t);
+                    }
+                }
+            };
+
+            // Estimate lookups in floating point domain, so that huge distance or radius does not overflow the cast.
+            // Origin out of the range of coord_t, which includes NaN, is not walked either, as its cell is clamped.
+            const auto end = origin + unit_direction * max_distance;
+            const auto walked_cells = std::abs(std::floor(end.x / cell_size.x) - std::floor(origin.x / cell_size.x)) +
+                                      std::abs(std::floor(end.y / cell_size.y) - std::floor(origin.y / cell_size.y)) + 1;
+            const auto strip_cells = 2 * std::max(std::ceil(radius / cell_size.x), std::ceil(radius / cell_size.y)) + 1;
+            const auto in_range = [](T coord){
+                return static_cast<T>(std::numeric_limits<coord_t>::min()) < coord && coord < static_cast<T>(std::numeric_limits<coord_t>::max());
+            };
+            if (!(walked_cells * strip_cells <= static_cast<T>(table.size())) ||
+                !in_range(std::floor(origin.x / cell_size.x)) || !in_range(std::floor(origin.y / cell_size.y))){
+                for (const auto &entry : table){
+                    if (entry.cell != invalid_index){
+                        test_cell(cells[entry.cell], entry.row, entry.col);
+                    }
+                }
+                return;
+            }
+
+            const auto reach_col = static_cast<std::int64_t>(std::ceil(radius / cell_size.x));
+            const auto reach_row = static_cast<std::int64_t>(std::ceil(radius / cell_size.y));
+            auto col = static_cast<std::int64_t>(std::floor(origin.x / cell_size.x));
+            auto row = static_cast<std::int64_t>(std::floor(origin.y / cell_size.y));
+
+            const auto step_col = unit_direction.x > 0 ? 1 : -1;
+            const auto step_row = unit_direction.y > 0 ? 1 : -1;
+            const auto next_boundary = [](std::int64_t index, int step, T cell_length, T o, T d){
+                if (d == 0){
+                    return std::numeric_limits<T>::infinity();
+                }
+                return (static_cast<T>(step > 0 ? index + 1 : index) * cell_length - o) / d;
+            };
+            auto t_next_col = next_boundary(col, step_col, cell_size.x, origin.x, unit_direction.x);
+            auto t_next_row = next_boundary(row, step_row, cell_size.y, origin.y, unit_direction.y);
+            const auto t_delta_col = cell_size.x / std::abs(unit_direction.x);
+            const auto t_delta_row = cell_size.y / std::abs(unit_direction.y);
+
+            if (stop(T { 0 })){
+                return;
+            }
+            visitCells(row - reach_row, row + reach_row, col - reach_col, col + reach_col, test_cell);
+            while (true){
+                const auto step_horizontally = t_next_col < t_next_row;
+                const auto t_enter = step_horizontally ? t_next_col : t_next_row;
+                if (t_enter > max_distance || stop(t_enter)){
+                    return;
+                }
+
+                if (step_horizontally){
+                    t_next_col += t_delta_col;
+                    col += step_col;
+
+                    // A new column enters the neighborhood.
+                    const auto new_col = col + step_col * reach_col;
+                    visitCells(row - reach_row, row + reach_row, new_col, new_col, test_cell);
+                }
+                else{
+                    t_next_row += t_delta_row;
+                    row += step_row;
+
+                    const auto new_row = row + step_row * reach_row;
+                    visitCells(new_row, new_row, col - reach_col, col + reach_col, test_cell);
+                }
+            }
+        }
+
+        /**
+         * @brief Get references of \p k bodies nearest to \p position except the body of \p excluded_slot, in ascending
+         * order of distance.
+         *
+         * Cells are looked up ring by ring outward from the cell of \p position as in \p Grid, keeping the k nearest
+         * bodies found so far in a max-heap, until the nearest point of the next ring is not closer than the k-th body.
+         * Once the looked up square would have more cells than the table has entries, the remaining occupied cells are
+         * scanned from the table instead, so the search ends even if bodies are far apart.
+         */
+        std::vector<body_ref_t> findNearest(const Vector2<T> &position, std::size_t k, index_t excluded_slot) const{
+            std::vector<body_ref_t> result;
+            const auto candidate_count = slots.size() - (excluded_slot == invalid_index ? 0 : 1);
+            k = std::min(k, candidate_count);
+            if (k == 0){
+                return result;
+            }
+
+            const auto cell_size = cellSize();
+            const auto [center_row, center_col] = toCell(position.x, position.y);
+
+            // Max-heap of (square of distance, slot index), whose front is the k-th nearest body found so far.
+            std::vector<std::pair<T, index_t>> heap;
+            heap.reserve(k);
+
+            const auto visit_cell = [&](const Cell &cell, coord_t row, coord_t col){
+                if (heap.size() == k){
+                    // Skip cell if its nearest point is not closer than the k-th nearest body.
+                    const auto cell_left = static_cast<T>(col) * cell_size.x;
+                    const auto cell_top = static_cast<T>(row) * cell_size.y;
+                    const auto dx = std::max({ cell_left - position.x, position.x - (cell_left + cell_size.x), T { 0 } });
+                    const auto dy = std::max({ cell_top - position.y, position.y - (cell_top + cell_size.y), T { 0 } });
+                    if (dx * dx + dy * dy >= heap.front().first){
+                        return;
+                    }
+                }
+
+                for (std::size_t i = 0; i < cell.size(); ++i){
+                    if (cell.slots[i] == excluded_slot){
+                        continue;
+                    }
+
+                    const auto candidate = std::pair { position.distance2(Vector2<T> { cell.xs[i], cell.ys[i] }), cell.slots[i] };
+                    if (heap.size() < k){
+                        heap.push_back(candidate);
+                        std::ranges::push_heap(heap);
+                    }
+                    else if (candidate < heap.front()){
+                        std::ranges::pop_heap(heap);
+                        heap.back() = candidate;
+                        std::ranges::push_heap(heap);
+                    }
+                }
+            };
+
+            visitCells(center_row, center_row, center_col, center_col, visit_cell);
+            for (std::int64_t ring = 1;; ++ring){
+                if (heap.size() == k){
+                    // Cells of ring lie outside the square of cells inside it, so their distance is at least the gap
+                    // from position to the nearest side of the square.
+                    const auto gap = std::max({
+                        std::min({
+                            position.x - static_cast<T>(center_col - ring + 1) * cell_size.x,
+                            static_cast<T>(center_col + ring) * cell_size.x - position.x,
+                            position.y - static_cast<T>(center_row - ring + 1) * cell_size.y,
+                            static_cast<T>(center_row + ring) * cell_size.y - position.y,
+                        }),
+                        T { 0 },
+                    });
+                    if (gap * gap >= heap.front().first){
+                        break;
+                    }
+                }
+
+                if (static_cast<double>(2 * ring + 1) * static_cast<double>(2 * ring + 1) > static_cast<double>(table.size())){
+                    for (const auto &entry : table){
+                        if (entry.cell != invalid_index && std::max(std::abs(entry.row - std::int64_t { center_row }), std::abs(entry.col - std::int64_t { center_col })) >= ring){
+                            visit_cell(cells[entry.cell], entry.row, entry.col);
+                        }
+                    }
+                    break;
+                }
+
+                // Top and bottom sides of ring.
+                visitCells(center_row - ring, center_row - ring, center_col - ring, center_col + ring, visit_cell);
+                visitCells(center_row + ring, center_row + ring, center_col - ring, center_col + ring, visit_cell);
+
+                // Left and right sides of ring, except corners.
+                visitCells(center_row - ring + 1, center_row + ring - 1, center_col - ring, center_col - ring, visit_cell);
+                visitCells(center_row - ring + 1, center_row + ring - 1, center_col + ring, center_col + ring, visit_cell);
+            }
+
+            std::ranges::sort_heap(heap);
+            result.reserve(heap.size());
+            for (auto [distance2, slot_index] : heap){
+                result.push_back(slots[slot_index].body);
+            }
+            return result;
+        }
+
+    public:
+        const Vector2<T> cell_size;
+
+        /**
+         * @param cell_size Size of a cell.
+         * @param storage Storage policy that resolves body references.
+         * @throw std::invalid_argument If any component of \p cell_size is not positive in debug mode.
+         */
+        explicit HashGrid(const Vector2<T> &cell_size, const Storage &storage = {}) : storage(storage), cell_size(cell_size) {
+#ifndef NDEBUG
+            if (!(cell_size.x > 0 && cell_size.y > 0)) {
+                utils::throwInvalidArgument("HashGrid::HashGrid: cell size must be positive");
+            }
+#endif
+        }
+
+        /**
+         * @brief Get cell size of grid.
+         *
+         * @return Cell size in vec2 form (x=width, y=height).
+         */
+        Vector2<T> cellSize() const noexcept{
+            return cell_size;
+        }
+
+        /**
+         * @brief Get cell index of position.
+         *
+         * @param position Position to get cell index. It may be anywhere.
+         * @return Cell index in std::array form (row, col), which may be negative. It is clamped to the range of
+         * \p coord_t, and it is (0, 0) for NaN.
+         */
+        std::array<coord_t, 2> getCellIndex(const Vector2<T> &position) const noexcept{
+            return toCell(position.x, position.y);
+        }
+
+        /**
+         * @brief Get number of bodies in grid.
+         * @return Number of bodies in grid.
+         */
+        [[nodiscard]] std::size_t getBodyCount() const noexcept{
+            return slots.size();
+        }
+
+        /**
+         * @brief Get number of occupied cells, which are the only cells stored.
+         * @return Number of occupied cells.
+         */
+        [[nodiscard]] std::size_t getCellCount() const noexcept{
+            return num_cells;
+        }
+
+        /**
+         * @brief Get number of bodies in a cell.
+         *
+         * @param row Row of the cell.
+         * @param col Column of the cell.
+         * @return Number of bodies in the cell.
+         */
+        [[nodiscard]] std::size_t getCellBodyCount(coord_t row, coord_t col) const noexcept{
+            const auto cell = findCell(row, col);
+            return cell ? cell->size() : 0;
+        }
+
+        /**
+         * @brief Check if \p handle refers to a body in grid.
+         *
+         * @param handle Handle to check.
+         * @return true if body of \p handle is not removed, false otherwise.
+         */
+        [[nodiscard]] bool contains(BodyHandle handle) const noexcept{
+            return slots.contains(handle);
+        }
+
+        /**
+         * @brief Get body of \p handle.
+         *
+         * @param handle Handle of body.
+         * @return Reference of body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        Body &getBody(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HashGrid::getBody: invalid handle");
+            }
+#endif
+            return storage.get(slots[handle.index].body);
+        }
+
+        /**
+         * @brief Add body to grid.
+         *
+         * @param body Reference of body to add, which is convertible to \p body_ref_t.
+         * @return Handle of added body.
+         */
+        BodyHandle addBody(auto &&body){
+            static_assert(std::is_convertible_v<decltype(body), body_ref_t>);
+
+            const auto handle = slots.insert({ .body = std::forward<decltype(body)>(body) });
+            auto &slot = slots[handle.index];
+            const auto position = PositionGetter()(storage.get(slot.body));
+            const auto cell = toCell(position.x, position.y);
+            slot.row = cell[0];
+            slot.col = cell[1];
+            insertIntoCell(handle.index, position);
+
+            return handle;
+        }
+
+        /**
+         * @brief Remove body from grid in O(1) on average.
+         *
+         * @param handle Handle of body to remove. It is invalidated.
+         * @return true if body is removed, false if \p handle was not valid.
+         */
+        bool removeBody(BodyHandle handle) noexcept{
+            if (!contains(handle)){
+                return false;
+            }
+
+            eraseFromCell(handle.index);
+            slots.erase(handle);
+
+            return true;
+        }
+
+        /**
+         * @brief Clear all bodies in grid. All handles are invalidated. The hash table and the pooled cells keep their capacity.
+         */
+        void clearAllBodies() noexcept{
+            std::ranges::fill(table, Entry {});
+            num_cells = 0;
+            free_cells.clear();
+            for (index_t cell_index = 0; cell_index < cells.size(); ++cell_index){
+                cells[cell_index].clear();
+                free_cells.push_back(cell_index);
+            }
+
+            slots.clear();
+        }
+
+        /**
+         * @brief Update body's cell and cached position when its position is changed, in O(1) on average.
+         *
+         * @param handle Handle of body to update.
+         * @return New cell index of the body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::array<coord_t, 2> updateBodyCell(BodyHandle handle){
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HashGrid::updateBodyCell: invalid handle");
+            }
+#endif
+            auto &slot = slots[handle.index];
+            const auto position = PositionGetter()(storage.get(slot.body));
+            const auto cell = toCell(position.x, position.y);
+            if (cell == std::array { slot.row, slot.col }){
+                cells[slot.cell].xs[slot.offset] = position.x;
+                cells[slot.cell].ys[slot.offset] = position.y;
+            }
+            else{
+                eraseFromCell(handle.index);
+                slot.row = cell[0];
+                slot.col = cell[1];
+                insertIntoCell(handle.index, position);
+            }
+
+            return cell;
+        }
+
+        /**
+         * @brief Get bodies in grid that distance from \p body is less than \p distance.
+         *
+         * @param body Body to query, which is excluded from the result.
+         * @param distance Distance to query.
+         * @return A vector of all bodies distance less than \p distance.
+         */
+        std::vector<body_ref_t> queryDistance(const Body &body, T distance) const{
+            std::vector<body_ref_t> result;
+            const auto position = PositionGetter()(body);
+            visitNearbyBodies(position.x, position.y, invalid_index, distance, [&](index_t slot_index){
+                if (&storage.get(slots[slot_index].body) != &body){ // except body itself
+                    result.push_back(slots[slot_index].body);
+                }
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid that distance from \p body is less than \p distance. It does
+         * not allocate memory.
+         *
+         * @param body Body to query, which is excluded.
+         * @param distance Distance to query.
+         * @param visitor Function to be invoked with reference of each nearby body.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryDistance(const Body &body, T distance, Visitor &&visitor) const{
+            const auto position = PositionGetter()(body);
+            visitNearbyBodies(position.x, position.y, invalid_index, distance, [&](index_t slot_index){
+                auto &other = storage.get(slots[slot_index].body);
+                if (&other != &body){ // except body itself
+                    visitor(other);
+                }
+            });
+        }
+
+        /**
+         * @brief Get bodies in grid that distance from body of \p handle is less than \p distance.
+         *
+         * Position of the body is taken from the grid, as of its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body to query.
+         * @param distance Distance to query.
+         * @return A vector of all bodies distance less than \p distance.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::vector<body_ref_t> queryDistance(BodyHandle handle, T distance) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HashGrid::queryDistance: invalid handle");
+            }
+#endif
+            std::vector<body_ref_t> result;
+            const auto position = getPosition(handle.index);
+            visitNearbyBodies(position.x, position.y, handle.index, distance, [&](index_t slot_index){
+                result.push_back(slots[slot_index].body);
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid that distance from body of \p handle is less than
+         * \p distance. It does not allocate memory.
+         *
+         * @param handle Handle of body to query.
+         * @param distance Distance to query.
+         * @param visitor Function to be invoked with reference of each nearby body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryDistance(BodyHandle handle, T distance, Visitor &&visitor) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HashGrid::queryDistance: invalid handle");
+            }
+#endif
+            const auto position = getPosition(handle.index);
+            visitNearbyBodies(position.x, position.y, handle.index, distance, [&](index_t slot_index){
+                visitor(storage.get(slots[slot_index].body));
+            });
+        }
+
+        /**
+         * @brief Get all body pairs that distance between them is less than \p distance.
+         * @param distance Distance to query.
+         * @return A vector of body pairs. Each pair appears exactly once, in either order.
+         */
+        std::vector<std::array<body_ref_t, 2>> queryDistancePair(T distance) const{
+            std::vector<std::array<body_ref_t, 2>> result;
+            visitNearbyPairs(distance, [&](index_t slot1, index_t slot2){
+                result.push_back({ slots[slot1].body, slots[slot2].body });
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body pair that distance between them is less than \p distance.
+         *
+         * Each pair is visited exactly once, in either order. Unlike the overload that returns a vector, it does not
+         * allocate memory nor copy any body reference.
+         *
+         * @param distance Distance to query.
+         * @param visitor Function to be invoked with references of both bodies of each pair.
+         */
+        template <std::invocable<Body&, Body&> Visitor>
+        void queryDistancePair(T distance, Visitor &&visitor) const{
+            visitNearbyPairs(distance, [&](index_t slot1, index_t slot2){
+                visitor(storage.get(slots[slot1].body), storage.get(slots[slot2].body));
+            });
+        }
+
+        /**
+         * @brief Get bodies in grid inside \p rect, including its boundary.
+         *
+         * @param rect Rectangle to query.
+         * @return A vector of all bodies inside \p rect.
+         */
+        std::vector<body_ref_t> queryRect(const Rect<T> &rect) const{
+            std::vector<body_ref_t> result;
+            visitBodiesInRect(rect, [&](index_t slot_index){
+                result.push_back(slots[slot_index].body);
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid inside \p rect, including its boundary. It does not allocate
+         * memory.
+         *
+         * @param rect Rectangle to query.
+         * @param visitor Function to be invoked with reference of each body inside \p rect.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryRect(const Rect<T> &rect, Visitor &&visitor) const{
+            visitBodiesInRect(rect, [&](index_t slot_index){
+                visitor(storage.get(slots[slot_index].body));
+            });
+        }
+
+        /**
+         * @brief Get the first body hit by ray, regarding each body as a circle of \p radius.
+         *
+         * Cells are walked along ray from \p origin, and the walk stops at the first cell that the ray enters after
+         * the nearest hit found so far. If the walk is longer than the table, occupied cells are tested instead. For a
+         * segment cast from \p a to \p b, pass \p b - \p a as \p direction and its length as \p max_distance.
+         *
+         * @param origin Origin of ray. It may be anywhere.
+         * @param direction Direction of ray, which does not have to be normalized.
+         * @param max_distance Maximum distance of ray. It may be infinite.
+         * @param radius Radius of bodies.
+         * @return The nearest hit, or \p std::nullopt if ray does not hit any body. If \p origin is inside a body, it is
+         * hit at distance 0.
+         * @throw std::invalid_argument If \p direction is zero in debug mode.
+         */
+        std::optional<RaycastHit> raycast(const Vector2<T> &origin, const Vector2<T> &direction, T max_distance, T radius = 0) const{
+            auto nearest_slot = invalid_index;
+            auto nearest_distance = std::numeric_limits<T>::infinity();
+            visitRayHits(origin, direction, max_distance, radius, [&](T t_enter){
+                return nearest_distance <= t_enter;
+            }, [&](index_t slot_index, T distance){
+                if (distance < nearest_distance){
+                    nearest_slot = slot_index;
+                    nearest_distance = distance;
+                }
+            });
+
+            if (nearest_slot == invalid_index){
+                return std::nullopt;
+            }
+            return RaycastHit { slots[nearest_slot].body, nearest_distance };
+        }
+
+        /**
+         * @brief Get all bodies hit by ray, regarding each body as a circle of \p radius.
+         *
+         * @param origin Origin of ray. It may be anywhere.
+         * @param direction Direction of ray, which does not have to be normalized.
+         * @param max_distance Maximum distance of ray. It may be infinite.
+         * @param radius Radius of bodies.
+         * @return A vector of hits, in ascending order of distance.
+         * @throw std::invalid_argument If \p direction is zero in debug mode.
+         */
+        std::vector<RaycastHit> raycastAll(const Vector2<T> &origin, const Vector2<T> &direction, T max_distance, T radius = 0) const{
+            std::vector<RaycastHit> result;
+            visitRayHits(origin, direction, max_distance, radius, [](T){
+                return false;
+            }, [&](index_t slot_index, T distance){
+                result.push_back({ slots[slot_index].body, distance });
+            });
+
+            std::ranges::stable_sort(result, {}, &RaycastHit::distance);
+            return result;
+        }
+
+        /**
+         * @brief Get \p k bodies in grid nearest to \p position.
+         *
+         * Cells are searched ring by ring outward from the cell of \p position, and the search stops as soon as the
+         * next ring cannot contain a body nearer than the k-th nearest one. If bodies are too sparse for the rings to
+         * reach them within as many lookups as the table has entries, occupied cells are scanned instead.
+         *
+         * @param position Position to query. It may be anywhere.
+         * @param k Number of bodies to find.
+         * @return A vector of min(\p k, body count) bodies, in ascending order of distance.
+         */
+        std::vector<body_ref_t> queryNearest(const Vector2<T> &position, std::size_t k) const{
+            return findNearest(position, k, invalid_index);
+        }
+
+        /**
+         * @brief Get \p k bodies in grid nearest to body of \p handle, except the body itself.
+         *
+         * Position of the body is taken from the grid, as of its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body to query.
+         * @param k Number of bodies to find.
+         * @return A vector of min(\p k, body count - 1) bodies, in ascending order of distance.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::vector<body_ref_t> queryNearest(BodyHandle handle, std::size_t k) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HashGrid::queryNearest: invalid handle");
+            }
+#endif
+            return findNearest(getPosition(handle.index), k, handle.index);
+        }
+    };
+};
+
+#endif //SPATIAL_HASH_GRID_HPP
@@ -0,0 +1,425 @@
+#ifndef SPATIAL_HIERARCHICAL_GRID_HPP
+#define SPATIAL_HIERARCHICAL_GRID_HPP
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "body_storage.hpp"
+#include "loose_grid.hpp"
+#include "rect.hpp"
+#include "utils/slot_map.hpp"
+#include "utils/thrower.hpp"
+#include "utils/macros.hpp"
+
+namespace spatial{
+    /**
+     * @brief Hierarchy of loose grids over the same bound, whose cell size doubles level by level.
+     *
+     * Level 0 has \p rows x \p columns cells, and each next level has half as many rows and columns (rounded up). A
+     * body is put in the coarsest level whose cell at its center has fewer than \p cell_capacity bodies, among the
+     * levels whose cells are not smaller than the body. So sparse regions are served by a few coarse cells, while dense
+     * regions spill down into finer levels, and the number of candidates a query tests in each level stays bounded by
+     * the capacity except in the finest level. A body keeps its level while it moves, unless it grows larger than the
+     * cells of the level, or it moves into a cell that is already full and a finer level can take it.
+     *
+     * Queries walk all levels, testing only the cells of each level that cover the query.
+     */
+    template <std::floating_point T, typename Body, typename BoundsGetter, BodyStorage<Body> Storage = SharedBodyStorage<Body>>
+    requires std::invocable<BoundsGetter, const Body&> &&
+             std::is_same_v<std::invoke_result_t<BoundsGetter, const Body&>, Rect<T>>
+    class HierarchicalGrid{
+    public:
+        using index_t = std::uint32_t;
+        using body_ref_t = typename Storage::reference_type; // How the grid refers to a body.
+        using level_t = LooseGrid<T, Body, BoundsGetter, Storage>;
+
+        /**
+         * @brief Stable handle of a body in grid, returned by \p addBody. It stays valid even if the body moves to
+         * another level.
+         */
+        using BodyHandle = utils::SlotHandle;
+
+    private:
+        static constexpr index_t invalid_level = std::numeric_limits<index_t>::max();
+
+        /**
+         * @brief Body with the level and the handle in the level it is in.
+         */
+        struct Slot{
+            index_t level = invalid_level; // Level that body is in, or invalid_level if slot is free.
+            typename level_t::BodyHandle handle {};
+        };
+
+        Storage storage;
+        std::vector<level_t> levels;
+        utils::SlotMap<Slot> slots;
+
+        /**
+         * @brief Get finest level whose cells are not smaller than a body of \p bounds. If no level is large enough,
+         * the coarsest one.
+         */
+        index_t getFinestLevel(const Rect<T> &bounds) const noexcept{
+            for (index_t level = 0; level < levels.size(); ++level){
+                const auto cell_size = levels[level].cellSize();
+                if (bounds.size.x <= cell_size.x && bounds.size.y <= cell_size.y){
+                    return level;
+                }
+            }
+            return static_cast<index_t>(levels.size() - 1);
+        }
+
+        /**
+         * @brief Get level to put a body of \p bounds in.
+         */
+        index_t chooseLevel(const Rect<T> &bounds) const noexcept{
+            const auto finest_level = getFinestLevel(bounds);
+            for (auto level = static_cast<index_t>(levels.size() - 1); level > finest_level; --level){
+                const auto [row, col] = levels[level].getCellIndex(bounds);
+                if (levels[level].getCellBodyCount(row, col) < cell_capacity){
+                    return level;
+                }
+            }
+            return finest_level;
+        }
+
+        /**
+         * @brief Put body of \p slot_index in the level chosen for its bounds.
+         */
+        void insertIntoLevel(index_t slot_index, const body_ref_t &body){
+            const auto level = chooseLevel(BoundsGetter()(storage.get(body)));
+            slots[slot_index].level = level;
+            slots[slot_index].handle = levels[level].addBody(body);
+        }
+
+        /**
+         * @brief Invoke \p func with reference of each body whose bounds overlap \p rect, except the body of
+         * \p excluded_handle in level \p excluded_level.
+         */
+        template <typename F>
+        void visitOverlaps(const Rect<T> &rect, index_t excluded_level, typename level_t::BodyHandle excluded_handle, F &&func) const{
+            for (index_t level = 0; level < levels.size(); ++level){
+                if (level == excluded_level){
+                    levels[level].queryOverlap(excluded_handle, func);
+                }
+                else{
+                    levels[level].queryRect(rect, func);
+                }
+            }
+        }
+
+    public:
+        const Rect<T> bound;
+        const std::size_t cell_capacity;
+
+        /**
+         * @param bound Bound of grid.
+         * @param rows Number of rows of the finest level.
+         * @param columns Number of columns of the finest level.
+         * @param level_count Number of levels.
+         * @param cell_capacity Number of bodies a cell of a level other than the finest one for a body takes before
+         * bodies spill down into a finer level.
+         * @param storage Storage policy that resolves body references.
+         * @throw std::invalid_argument If \p rows, \p columns or \p level_count is 0 in debug mode.
+         */
+        HierarchicalGrid(const Rect<T> &bound, std::size_t rows, std::size_t columns, std::size_t level_count, std::size_t cell_capacity, const Storage &storage = {})
+                : storage(storage), bound(bound), cell_capacity(cell_capacity) {
+#ifndef NDEBUG
+            if (rows == 0 || columns == 0 || level_count == 0) {
+                utils::throwInvalidArgument("HierarchicalGrid::HierarchicalGrid: rows, columns and level_count must be greater than 0");
+            }
+#endif
+            levels.reserve(level_count);
+            for (std::size_t level = 0; level < level_count; ++level){
+                const auto level_rows = (rows + (std::size_t { 1 } << level) - 1) >> level;
+                const auto level_columns = (columns + (std::size_t { 1 } << level) - 1) >> level;
+                levels.emplace_back(bound, level_rows, level_columns, storage);
+            }
+        }
+
+        /**
+         * @brief Get number of levels.
+         * @return Number of levels.
+         */
+        [[nodiscard]] std::size_t getLevelCount() const noexcept{
+            return levels.size();
+        }
+
+        /**
+         * @brief Get a level.
+         *
+         * @param level Index of level, where 0 is the finest one.
+         * @return Loose grid of the level.
+         */
+        const level_t &getLevel(std::size_t level) const noexcept{
+            return levels[level];
+        }
+
+        /**
+         * @brief Get level that body of \p handle is in.
+         *
+         * @param handle Handle of body.
+         * @return Index of level.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        [[nodiscard]] std::size_t getBodyLevel(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HierarchicalGrid::getBodyLevel: invalid handle");
+            }
+#endif
+            return slots[handle.index].level;
+        }
+
+        /**
+         * @brief Get number of bodies in grid.
+         * @return Number of bodies in grid.
+         */
+        [[nodiscard]] std::size_t getBodyCount() const noexcept{
+            return slots.size();
+        }
+
+        /**
+         * @brief Check if \p handle refers to a body in grid.
+         *
+         * @param handle Handle to check.
+         * @return true if body of \p handle is not removed, false otherwise.
+         */
+        [[nodiscard]] bool contains(BodyHandle handle) const noexcept{
+            return slots.contains(handle);
+        }
+
+        /**
+         * @brief Get body of \p handle.
+         *
+         * @param handle Handle of body.
+         * @return Reference of body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        Body &getBody(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HierarchicalGrid::getBody: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            return levels[slot.level].getBody(slot.handle);
+        }
+
+        /**
+         * @brief Add body to grid, in the level chosen by its size and the occupancy of the cells at its center.
+         *
+         * @param body Reference of body to add, which is convertible to \p body_ref_t.
+         * @return Handle of added body.
+         */
+        BodyHandle addBody(auto &&body){
+            static_assert(std::is_convertible_v<decltype(body), body_ref_t>);
+
+            const auto handle = slots.insert();
+            insertIntoLevel(handle.index, std::forward<decltype(body)>(body));
+
+            return handle;
+        }
+
+        /**
+         * @brief Remove body from grid in O(1).
+         *
+         * @param handle Handle of body to remove. It is invalidated.
+         * @return true if body is removed, false if \p handle was not valid.
+         */
+        bool removeBody(BodyHandle handle) noexcept{
+            if (!contains(handle)){
+                return false;
+            }
+
+            const auto &slot = slots[handle.index];
+            levels[slot.level].removeBody(slot.handle);
+            slots.erase(handle);
+
+            return true;
+        }
+
+        /**
+         * @brief Clear all bodies in grid. All handles are invalidated.
+         */
+        void clearAllBodies() noexcept{
+            for (auto &level : levels){
+                level.clearAllBodies();
+            }
+
+            slots.clear();
+        }
+
+        /**
+         * @brief Update body's cell when its bounds are changed.
+         *
+         * Body stays in its level in O(1), unless it became larger than the cells of the level, or its new cell holds
+         * more than \p cell_capacity bodies while a finer level could take it. In either case, it is put in a level
+         * again as by \p addBody.
+         *
+         * @param handle Handle of body to update.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        void updateBodyCell(BodyHandle handle){
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HierarchicalGrid::updateBodyCell: invalid handle");
+            }
+#endif
+            auto &slot = slots[handle.index];
+            auto &level = levels[slot.level];
+            const auto finest_level = getFinestLevel(BoundsGetter()(level.getBody(slot.handle)));
+            if (finest_level <= slot.level){
+                level.updateBodyCell(slot.handle);
+
+                if (finest_level == slot.level){
+                    return;
+                }
+                const auto [row, col] = level.getCellIndex(slot.handle);
+                if (level.getCellBodyCount(row, col) <= cell_capacity){
+                    return;
+                }
+            }
+
+            const body_ref_t body = level.getBodyReference(slot.handle);
+            level.removeBody(slot.handle);
+            insertIntoLevel(handle.index, body);
+        }
+
+        /**
+         * @brief Get bodies in grid whose bounds overlap \p rect, including touching ones.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @return A vector of all bodies overlapping \p rect.
+         */
+        std::vector<body_ref_t> queryRect(const Rect<T> &rect) const{
+            std::vector<body_ref_t> result;
+            for (const auto &level : levels){
+                const auto level_result = level.queryRect(rect);
+                result.insert(result.end(), level_result.begin(), level_result.end());
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid whose bounds overlap \p rect, including touching ones. It does
+         * not allocate memory.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @param visitor Function to be invoked with reference of each body overlapping \p rect.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryRect(const Rect<T> &rect, Visitor &&visitor) const{
+            visitOverlaps(rect, invalid_level, {}, visitor);
+        }
+
+        /**
+         * @brief Get bodies in grid whose bounds overlap bounds of body of \p handle, except the body itself.
+         *
+         * @param handle Handle of body to query.
+         * @return A vector of all bodies overlapping the body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::vector<body_ref_t> queryOverlap(BodyHandle handle) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HierarchicalGrid::queryOverlap: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            const auto bounds = levels[slot.level].getBounds(slot.handle);
+
+            std::vector<body_ref_t> result;
+            for (index_t level = 0; level < levels.size(); ++level){
+                const auto level_result = level == slot.level ? levels[level].queryOverlap(slot.handle) : levels[level].queryRect(bounds);
+                result.insert(result.end(), level_result.begin(), level_result.end());
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid whose bounds overlap bounds of body of \p handle, except the
+         * body itself. It does not allocate memory.
+         *
+         * @param handle Handle of body to query.
+         * @param visitor Function to be invoked with reference of each overlapping body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryOverlap(BodyHandle handle, Visitor &&visitor) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("HierarchicalGrid::queryOverlap: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            visitOverlaps(levels[slot.level].getBounds(slot.handle), slot.level, slot.handle, visitor);
+        }
+
+        /**
+         * @brief Get all body pairs whose bounds overlap, including touching ones.
+         *
+         * @return A vector of body pairs. Each pair appears exactly once, in either order.
+         */
+        std::vector<std::array<body_ref_t, 2>> queryOverlapPair() const{
+            std::vector<std::array<body_ref_t, 2>> result;
+            for (const auto &level : levels){
+                const auto level_result = level.queryOverlapPair();
+                result.insert(result.end(), level_result.begin(), level_result.end());
+            }
+
+            for (index_t slot_index = 0; slot_index < slots.slotCount(); ++slot_index){
+                if (!slots.isAlive(slot_index)){
+                    continue;
+                }
+
+                const auto &slot = slots[slot_index];
+                const auto &body = levels[slot.level].getBodyReference(slot.handle);
+                const auto bounds = levels[slot.level].getBounds(slot.handle);
+                for (auto level = slot.level + 1; level < levels.size(); ++level){
+                    for (const auto &other : levels[level].queryRect(bounds)){
+                        result.push_back({ body, other });
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body pair whose bounds overlap, including touching ones.
+         *
+         * Pairs in the same level are found by the level. Pairs across levels are found by querying the bounds of each
+         * body in the coarser levels than its own, so each pair is visited exactly once, in either order.
+         *
+         * @param visitor Function to be invoked with references of both bodies of each pair.
+         */
+        template <std::invocable<Body&, Body&> Visitor>
+        void queryOverlapPair(Visitor &&visitor) const{
+            for (const auto &level : levels){
+                level.queryOverlapPair(visitor);
+            }
+
+            for (index_t slot_index = 0; slot_index < slots.slotCount(); ++slot_index){
+                if (!slots.isAlive(slot_index)){
+                    continue;
+                }
+
+                const auto &slot = slots[slot_index];
+                auto &body = levels[slot.level].getBody(slot.handle);
+                const auto bounds = levels[slot.level].getBounds(slot.handle);
+                for (auto level = slot.level + 1; level < levels.size(); ++level){
+                    levels[level].queryRect(bounds, [&](Body &other){
+                        visitor(body, other);
+                    });
+                }
+            }
+        }
+    };
+};
+
+#endif //SPATIAL_HIERARCHICAL_GRID_HPP
@@ -0,0 +1,596 @@
+#ifndef SPATIAL_LOOSE_GRID_HPP
+#define SPATIAL_LOOSE_GRID_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "body_storage.hpp"
+#include "rect.hpp"
+#include "utils/matrix.hpp"
+#include "utils/slot_map.hpp"
+#include "utils/thrower.hpp"
+#include "utils/macros.hpp"
+
+namespace spatial{
+    /**
+     * @brief Loose uniform grid of bodies with extents, where each body is stored once in the cell of its center.
+     *
+     * Every cell is regarded as inflated by the largest half size of bodies, so that it loosely contains the bounds of
+     * its bodies, and queries expand their cell range by the same amount. Unlike \p ExtentGrid, adding, removing and
+     * updating a body is O(1) regardless of its size, at the cost of scanning more cells per query when sizes vary a
+     * lot. The largest half size grows as bodies are added or updated, and is reset only by \p clearAllBodies.
+     */
+    template <std::floating_point T, typename Body, typename BoundsGetter, BodyStorage<Body> Storage = SharedBodyStorage<Body>>
+    requires std::invocable<BoundsGetter, const Body&> &&
+             std::is_same_v<std::invoke_result_t<BoundsGetter, const Body&>, Rect<T>>
+    class LooseGrid{
+    public:
+        using index_t = std::uint32_t;
+        using body_ref_t = typename Storage::reference_type; // How the grid refers to a body.
+
+        /**
+         * @brief Stable handle of a body in grid, returned by \p addBody.
+         */
+        using BodyHandle = utils::SlotHandle;
+
+    private:
+        static constexpr index_t invalid_index = std::numeric_limits<index_t>::max();
+
+        /**
+         * @brief Body with its location in grid. It acts as a back-pointer from a handle to the cell.
+         */
+        struct Slot{
+            body_ref_t body {};
+            index_t cell = invalid_index; // Linear index of cell that body is in, or invalid_index if slot is free.
+            index_t offset = 0; // Offset of body in its cell.
+        };
+
+        /**
+         * @brief Bodies in a cell with their bounds cached in structure-of-arrays form.
+         */
+        struct Cell{
+            std::vector<index_t> slots; // Slot indices of bodies.
+            std::vector<T> lefts; // Bounds of bodies, captured at addBody and updateBodyCell.
+            std::vector<T> tops;
+            std::vector<T> rights;
+            std::vector<T> bottoms;
+
+            [[nodiscard]] std::size_t size() const noexcept { return slots.size(); }
+
+            void push(index_t slot, const std::array<T, 4> &bounds){
+                slots.push_back(slot);
+                lefts.push_back(bounds[0]);
+                tops.push_back(bounds[1]);
+                rights.push_back(bounds[2]);
+                bottoms.push_back(bounds[3]);
+            }
+
+            void setBounds(std::size_t offset, const std::array<T, 4> &bounds) noexcept{
+                lefts[offset] = bounds[0];
+                tops[offset] = bounds[1];
+                rights[offset] = bounds[2];
+                bottoms[offset] = bounds[3];
+            }
+
+            [[nodiscard]] bool overlaps(std::size_t offset, const std::array<T, 4> &bounds) const noexcept{
+                return lefts[offset] <= bounds[2] && bounds[0] <= rights[offset] &&
+                       tops[offset] <= bounds[3] && bounds[1] <= bottoms[offset];
+            }
+
+            [[nodiscard]] std::array<T, 4> getBounds(std::size_t offset) const noexcept{
+                return { lefts[offset], tops[offset], rights[offset], bottoms[offset] };
+            }
+
+            /**
+             * @brief Remove the \p offset-th body by swapping it with the last one.
+             * @return Slot index of the body moved into \p offset, or \p invalid_index if nothing is moved.
+             */
+            index_t erase(std::size_t offset) noexcept{
+                const auto moved_slot = offset + 1 == slots.size() ? invalid_index : slots.back();
+                slots[offset] = slots.back();
+                lefts[offset] = lefts.back();
+                tops[offset] = tops.back();
+                rights[offset] = rights.back();
+                bottoms[offset] = bottoms.back();
+
+                slots.pop_back();
+                lefts.pop_back();
+                tops.pop_back();
+                rights.pop_back();
+                bottoms.pop_back();
+
+                return moved_slot;
+            }
+
+            void clear() noexcept{
+                slots.clear();
+                lefts.clear();
+                tops.clear();
+                rights.clear();
+                bottoms.clear();
+            }
+        };
+
+        Storage storage;
+        std::size_t rows;
+        std::size_t columns;
+        utils::Matrix<Cell> cells;
+        utils::SlotMap<Slot> slots;
+        T max_half_width = 0;
+        T max_half_height = 0;
+
+        static std::array<T, 4> toBounds(const Rect<T> &rect) noexcept{
+            return { rect.left(), rect.top(), rect.right(), rect.bottom() };
+        }
+
+        /**
+         * @brief Get cell index of \p value in cell units along an axis, clamped to the border cells.
+         */
+        static index_t toIndex(T value, std::size_t count) noexcept{
+            return static_cast<index_t>(std::clamp(std::floor(value), T { 0 }, static_cast<T>(count - 1)));
+        }
+
+        /**
+         * @brief Get linear index of cell that center of \p bounds is in, clamped to the border cells.
+         */
+        index_t getLinearCellIndex(const std::array<T, 4> &bounds) const noexcept{
+            const auto cell_size = cellSize();
+            const auto row = toIndex(((bounds[1] + bounds[3]) / 2 - bound.top()) / cell_size.y, rows);
+            const auto col = toIndex(((bounds[0] + bounds[2]) / 2 - bound.left()) / cell_size.x, columns);
+            return static_cast<index_t>(row * columns + col);
+        }
+
+        Cell &getCell(index_t cell_index) noexcept{
+            return cells(cell_index / columns, cell_index % columns);
+        }
+
+        const Cell &getCell(index_t cell_index) const noexcept{
+            return cells(cell_index / columns, cell_index % columns);
+        }
+
+        void growMaxHalfSize(const std::array<T, 4> &bounds) noexcept{
+            max_half_width = std::max(max_half_width, (bounds[2] - bounds[0]) / 2);
+            max_half_height = std::max(max_half_height, (bounds[3] - bounds[1]) / 2);
+        }
+
+        /**
+         * @brief Put body of \p slot_index into cell at \p cell_index.
+         */
+        void insertIntoCell(index_t slot_index, index_t cell_index, const std::array<T, 4> &bounds){
+            auto &cell = getCell(cell_index);
+            slots[slot_index].cell = cell_index;
+            slots[slot_index].offset = static_cast<index_t>(cell.size());
+            cell.push(slot_index, bounds);
+        }
+
+        /**
+         * @brief Take body of \p slot_index out of its cell in O(1), fixing the offset of the body moved into its place.
+         */
+        void eraseFromCell(index_t slot_index) noexcept{
+            const auto &slot = slots[slot_index];
+            const auto moved_slot = getCell(slot.cell).erase(slot.offset);
+            if (moved_slot != invalid_index){
+                slots[moved_slot].offset = slot.offset;
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with slot index of each body except \p excluded_slot whose bounds overlap \p bounds.
+         *
+         * A body overlapping \p bounds has its center within \p bounds expanded by the largest half size, so only the
+         * cells covering the expanded bounds are scanned.
+         */
+        template <typename F>
+        void visitOverlaps(const std::array<T, 4> &bounds, index_t excluded_slot, F &&func) const{
+            const auto cell_size = cellSize();
+            const auto row_first = toIndex((bounds[1] - max_half_height - bound.top()) / cell_size.y, rows);
+            const auto row_last = toIndex((bounds[3] + max_half_height - bound.top()) / cell_size.y, rows);
+            const auto col_first = toIndex((bounds[0] - max_half_width - bound.left()) / cell_size.x, columns);
+            const auto col_last = toIndex((bounds[2] + max_half_width - bound.left()) / cell_size.x, columns);
+
+            for (auto row = row_first; row <= row_last; ++row){
+                for (auto col = col_first; col <= col_last; ++col){
+                    const auto &cell = cells(row, col);
+                    for (std::size_t i = 0; i < cell.size(); ++i){
+                        if (cell.slots[i] != excluded_slot && cell.overlaps(i, bounds)){
+                            func(cell.slots[i]);
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Invoke \p func with slot indices of each body pair whose bounds overlap.
+         *
+         * Centers of an overlapping pair are at most twice the largest half size apart, which bounds how many cells
+         * apart they can be. Each cell is checked against itself and against the cells within that reach on its right
+         * and lower side only, so every pair is found exactly once.
+         */
+        template <typename F>
+        void visitOverlapPairs(F &&func) const{
+            const auto cell_size = cellSize();
+            const auto reach_row = static_cast<std::size_t>(std::min(std::floor(2 * max_half_height / cell_size.y) + 1, static_cast<T>(rows)));
+            const auto reach_col = static_cast<std::size_t>(std::min(std::floor(2 * max_half_width / cell_size.x) + 1, static_cast<T>(columns)));
+
+            for (std::size_t row = 0; row < rows; ++row){
+                for (std::size_t col = 0; col < columns; ++col){
+                    const auto &cell = cells(row, col);
+                    for (std::size_t i = 0; i < cell.size(); ++i){
+                        const auto bounds = cell.getBounds(i);
+                        for (std::size_t j = i + 1; j < cell.size(); ++j){
+                            if (cell.overlaps(j, bounds)){
+                                func(cell.slots[i], cell.slots[j]);
+                            }
+                        }
+
+                        for (std::size_t row_offset = 0; row_offset <= reach_row && row + row_offset < rows; ++row_offset){
+                            const auto other_col_first = row_offset == 0 ? col + 1 : (col > reach_col ? col - reach_col : 0);
+                            const auto other_col_last = std::min(col + reach_col + 1, columns);
+                            for (auto other_col = other_col_first; other_col < other_col_last; ++other_col){
+                                const auto &other = cells(row + row_offset, other_col);
+                                for (std::size_t j = 0; j < other.size(); ++j){
+                                    if (other.overlaps(j, bounds)){
+                                        func(cell.slots[i], other.slots[j]);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+    public:
+        const Rect<T> bound;
+
+        /**
+         * @param bound Bound of grid.
+         * @param rows Number of rows.
+         * @param columns Number of columns.
+         * @param storage Storage policy that resolves body references.
+         * @throw std::invalid_argument If \p rows or \p columns is 0 in debug mode.
+         */
+        LooseGrid(const Rect<T> &bound, std::size_t rows, std::size_t columns, const Storage &storage = {})
+                : storage(storage), rows(rows), columns(columns), cells(rows, columns), bound(bound) {
+#ifndef NDEBUG
+            if (rows == 0 || columns == 0) {
+                utils::throwInvalidArgument("LooseGrid::LooseGrid: rows and columns must be greater than 0");
+            }
+#endif
+        }
+
+        /**
+         * @brief Get number of rows.
+         * @return Number of rows.
+         */
+        [[nodiscard]] std::size_t getRowCount() const noexcept{
+            return rows;
+        }
+
+        /**
+         * @brief Get number of columns.
+         * @return Number of columns.
+         */
+        [[nodiscard]] std::size_t getColumnCount() const noexcept{
+            return columns;
+        }
+
+        /**
+         * @brief Get cell size of grid.
+         *
+         * @return Cell size in vec2 form (x=width, y=height).
+         */
+        Vector2<T> cellSize() const NOEXCEPT_IF_RELEASE {
+            return bound.size.cwiseDiv(Vector2<T> { static_cast<T>(columns), static_cast<T>(rows) });
+        }
+
+        /**
+         * @brief Get the largest half size of bodies, by which cells are inflated.
+         *
+         * @return Largest half size in vec2 form (x=half width, y=half height).
+         */
+        Vector2<T> maxHalfSize() const noexcept{
+            return { max_half_width, max_half_height };
+        }
+
+        /**
+         * @brief Get number of bodies in grid.
+         * @return Number of bodies in grid.
+         */
+        [[nodiscard]] std::size_t getBodyCount() const noexcept{
+            return slots.size();
+        }
+
+        /**
+         * @brief Get cell index that a body of \p bounds would be put in.
+         *
+         * @param bounds Bounds of body.
+         * @return Cell index in std::array form (row, col).
+         */
+        std::array<std::size_t, 2> getCellIndex(const Rect<T> &bounds) const noexcept{
+            const auto cell_index = getLinearCellIndex(toBounds(bounds));
+            return { cell_index / columns, cell_index % columns };
+        }
+
+        /**
+         * @brief Get number of bodies in a cell.
+         *
+         * @param row Row of the cell.
+         * @param col Column of the cell.
+         * @return Number of bodies in the cell.
+         */
+        [[nodiscard]] std::size_t getCellBodyCount(std::size_t row, std::size_t col) const noexcept{
+            return cells(row, col).size();
+        }
+
+        /**
+         * @brief Get cell index that body of \p handle was put at its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body.
+         * @return Cell index in std::array form (row, col).
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::array<std::size_t, 2> getCellIndex(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("LooseGrid::getCellIndex: invalid handle");
+            }
+#endif
+            const auto cell_index = slots[handle.index].cell;
+            return { cell_index / columns, cell_index % columns };
+        }
+
+        /**
+         * @brief Check if \p handle refers to a body in grid.
+         *
+         * @param handle Handle to check.
+         * @return true if body of \p handle is not removed, false otherwise.
+         */
+        [[nodiscard]] bool contains(BodyHandle handle) const noexcept{
+            return slots.contains(handle);
+        }
+
+        /**
+         * @brief Get body of \p handle.
+         *
+         * @param handle Handle of body.
+         * @return Reference of body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        Body &getBody(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("LooseGrid::getBody: invalid handle");
+            }
+#endif
+            return storage.get(slots[handle.index].body);
+        }
+
+        /**
+         * @brief Get reference of body of \p handle, as the grid refers to it.
+         *
+         * @param handle Handle of body.
+         * @return Reference of body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        const body_ref_t &getBodyReference(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("LooseGrid::getBodyReference: invalid handle");
+            }
+#endif
+            return slots[handle.index].body;
+        }
+
+        /**
+         * @brief Get bounds of body of \p handle, as of its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body.
+         * @return Bounds of body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        Rect<T> getBounds(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("LooseGrid::getBounds: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            const auto [left, top, right, bottom] = getCell(slot.cell).getBounds(slot.offset);
+            return { left, top, right, bottom };
+        }
+
+        /**
+         * @brief Add body to grid, in the cell of the center of its bounds.
+         *
+         * The center may be out of bound, in which case the body is put in the nearest border cell.
+         *
+         * @param body Reference of body to add, which is convertible to \p body_ref_t.
+         * @return Handle of added body.
+         */
+        BodyHandle addBody(auto &&body){
+            static_assert(std::is_convertible_v<decltype(body), body_ref_t>);
+
+            body_ref_t reference = std::forward<decltype(body)>(body);
+            const auto bounds = toBounds(BoundsGetter()(storage.get(reference)));
+
+            const auto handle = slots.insert({ .body = std::move(reference) });
+            insertIntoCell(handle.index, getLinearCellIndex(bounds), bounds);
+            growMaxHalfSize(bounds);
+
+            return handle;
+        }
+
+        /**
+         * @brief Remove body from grid in O(1).
+         *
+         * @param handle Handle of body to remove. It is invalidated.
+         * @return true if body is removed, false if \p handle was not valid.
+         */
+        bool removeBody(BodyHandle handle) noexcept{
+            if (!contains(handle)){
+                return false;
+            }
+
+            eraseFromCell(handle.index);
+            slots.erase(handle);
+
+            return true;
+        }
+
+        /**
+         * @brief Clear all bodies in grid, and reset the largest half size. All handles are invalidated.
+         */
+        void clearAllBodies() noexcept{
+            for (std::size_t i = 0; i < rows; ++i){
+                for (std::size_t j = 0; j < columns; ++j){
+                    cells(i, j).clear();
+                }
+            }
+
+            slots.clear();
+            max_half_width = 0;
+            max_half_height = 0;
+        }
+
+        /**
+         * @brief Update body's cell and cached bounds when its bounds are changed, in O(1) regardless of its size.
+         *
+         * @param handle Handle of body to update.
+         * @return New cell index of the body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::array<std::size_t, 2> updateBodyCell(BodyHandle handle){
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("LooseGrid::updateBodyCell: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            const auto bounds = toBounds(BoundsGetter()(storage.get(slot.body)));
+            const auto cell_index = getLinearCellIndex(bounds);
+
+            if (cell_index == slot.cell) {
+                getCell(cell_index).setBounds(slot.offset, bounds);
+            }
+            else {
+                eraseFromCell(handle.index);
+                insertIntoCell(handle.index, cell_index, bounds);
+            }
+            growMaxHalfSize(bounds);
+
+            return { cell_index / columns, cell_index % columns };
+        }
+
+        /**
+         * @brief Get bodies in grid whose bounds overlap \p rect, including touching ones.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @return A vector of all bodies overlapping \p rect.
+         */
+        std::vector<body_ref_t> queryRect(const Rect<T> &rect) const{
+            std::vector<body_ref_t> result;
+            visitOverlaps(toBounds(rect), invalid_index, [&](index_t slot_index){
+                result.push_back(slots[slot_index].body);
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid whose bounds overlap \p rect, including touching ones. It does
+         * not allocate memory.
+         *
+         * @param rect Rectangle to query. It may be partially or entirely out of bound.
+         * @param visitor Function to be invoked with reference of each body overlapping \p rect.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryRect(const Rect<T> &rect, Visitor &&visitor) const{
+            visitOverlaps(toBounds(rect), invalid_index, [&](index_t slot_index){
+                visitor(storage.get(slots[slot_index].body));
+            });
+        }
+
+        /**
+         * @brief Get bodies in grid whose bounds overlap bounds of body of \p handle, except the body itself.
+         *
+         * Bounds of the body are taken from the grid, as of its last \p addBody or \p updateBodyCell.
+         *
+         * @param handle Handle of body to query.
+         * @return A vector of all bodies overlapping the body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        std::vector<body_ref_t> queryOverlap(BodyHandle handle) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("LooseGrid::queryOverlap: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            std::vector<body_ref_t> result;
+            visitOverlaps(getCell(slot.cell).getBounds(slot.offset), handle.index, [&](index_t slot_index){
+                result.push_back(slots[slot_index].body);
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body in grid whose bounds overlap bounds of body of \p handle, except the
+         * body itself. It does not allocate memory.
+         *
+         * @param handle Handle of body to query.
+         * @param visitor Function to be invoked with reference of each overlapping body.
+         * @throw std::out_of_range If \p handle is not valid in debug mode.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryOverlap(BodyHandle handle, Visitor &&visitor) const{
+#ifndef NDEBUG
+            if (!contains(handle)) {
+                utils::throwOutOfRange("LooseGrid::queryOverlap: invalid handle");
+            }
+#endif
+            const auto &slot = slots[handle.index];
+            visitOverlaps(getCell(slot.cell).getBounds(slot.offset), handle.index, [&](index_t slot_index){
+                visitor(storage.get(slots[slot_index].body));
+            });
+        }
+
+        /**
+         * @brief Get all body pairs whose bounds overlap, including touching ones.
+         *
+         * @return A vector of body pairs. Each pair appears exactly once, in either order.
+         */
+        std::vector<std::array<body_ref_t, 2>> queryOverlapPair() const{
+            std::vector<std::array<body_ref_t, 2>> result;
+            visitOverlapPairs([&](index_t slot1, index_t slot2){
+                result.push_back({ slots[slot1].body, slots[slot2].body });
+            });
+
+            return result;
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body pair whose bounds overlap, including touching ones.
+         *
+         * Each pair is visited exactly once, in either order. Unlike the overload that returns a vector, it does not
+         * allocate memory nor copy any body reference.
+         *
+         * @param visitor Function to be invoked with references of both bodies of each pair.
+         */
+        template <std::invocable<Body&, Body&> Visitor>
+        void queryOverlapPair(Visitor &&visitor) const{
+            visitOverlapPairs([&](index_t slot1, index_t slot2){
+                visitor(storage.get(slots[slot1].body), storage.get(slots[slot2].body));
+            });
+        }
+    };
+};
+
+#endif //SPATIAL_LOOSE_GRID_HPP
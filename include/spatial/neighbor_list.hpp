@@ -0,0 +1,259 @@
+#ifndef SPATIAL_NEIGHBOR_LIST_HPP
+#define SPATIAL_NEIGHBOR_LIST_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "grid.hpp"
+#include "utils/thrower.hpp"
+#include "utils/macros.hpp"
+
+namespace spatial{
+    /**
+     * @brief Verlet neighbor lists of bodies in a \p Grid, built for \p radius + \p skin.
+     *
+     * Each body's list holds the bodies within radius + skin at the last build, in compressed sparse row form. As long
+     * as no body has moved more than skin / 2 since then, every pair within radius is still in the lists, so queries
+     * only test list entries instead of scanning grid cells. \p update rebuilds the lists only when a body has moved
+     * farther, or bodies are added or removed.
+     *
+     * Lists refer to bodies by their slot in the grid, so the grid is passed to every call. Periodic grids are
+     * supported, with displacements following the minimum image convention.
+     */
+    template <std::floating_point T, typename Body, typename PositionGetter, BodyStorage<Body> Storage = SharedBodyStorage<Body>,
+              utils::MatrixLayout CellLayout = utils::RowMajorLayout>
+    class NeighborList{
+    public:
+        using grid_t = Grid<T, Body, PositionGetter, Storage, CellLayout>;
+        using index_t = typename grid_t::index_t;
+        using BodyHandle = typename grid_t::BodyHandle;
+
+    private:
+        static constexpr index_t invalid_index = std::numeric_limits<index_t>::max();
+
+        std::vector<index_t> offsets; // Neighbors of slot i are in [offsets[i], offsets[i + 1]) of neighbors.
+        std::vector<index_t> neighbors; // Slot indices of neighbors.
+        std::vector<index_t> generations; // Generation of body in each slot at the last build, or invalid_index if free.
+        std::vector<T> xs; // x position of body in each slot at the last build.
+        std::vector<T> ys; // y position of body in each slot at the last build.
+        std::size_t build_count = 0;
+
+        // Scratch buffers of build.
+        std::vector<std::array<index_t, 2>> build_pairs;
+        std::vector<index_t> build_cursors;
+
+        /**
+         * @brief Get displacement from \p from to \p to, of the nearest image in periodic grid.
+         */
+        static Vector2<T> displacement(const grid_t &grid, const Vector2<T> &from, const Vector2<T> &to) noexcept{
+            auto delta = to - from;
+            if (grid.boundary == GridBoundary::Periodic){
+                delta.x -= std::round(delta.x / grid.bound.size.x) * grid.bound.size.x;
+                delta.y -= std::round(delta.y / grid.bound.size.y) * grid.bound.size.y;
+            }
+            return delta;
+        }
+
+        static Vector2<T> currentPosition(const grid_t &grid, index_t slot_index) NOEXCEPT_IF_RELEASE{
+            return PositionGetter()(grid.getBody(grid.getBodyHandle(slot_index)));
+        }
+
+    public:
+        const T radius;
+        const T skin;
+
+        /**
+         * @param radius Interaction radius of queries.
+         * @param skin Margin added to \p radius when lists are built. Larger skin rebuilds less often, but makes lists
+         * longer.
+         * @throw std::invalid_argument If \p radius or \p skin is negative in debug mode.
+         */
+        NeighborList(T radius, T skin) : radius(radius), skin(skin) {
+#ifndef NDEBUG
+            if (radius < 0 || skin < 0) {
+                utils::throwInvalidArgument("NeighborList::NeighborList: radius and skin must not be negative");
+            }
+#endif
+        }
+
+        /**
+         * @brief Build lists of all bodies in \p grid, from one pair query of the grid for radius + skin.
+         *
+         * Cells and cached positions of \p grid must be up to date, i.e. \p updateBodyCell is called for every moved
+         * body.
+         *
+         * @param grid Grid of bodies.
+         */
+        void build(const grid_t &grid){
+            const auto slot_count = grid.getSlotCount();
+            generations.resize(slot_count);
+            xs.resize(slot_count);
+            ys.resize(slot_count);
+            for (index_t slot_index = 0; slot_index < slot_count; ++slot_index){
+                const auto handle = grid.getBodyHandle(slot_index);
+                if (grid.contains(handle)){
+                    generations[slot_index] = handle.generation;
+                    const auto position = PositionGetter()(grid.getBody(handle));
+                    xs[slot_index] = position.x;
+                    ys[slot_index] = position.y;
+                }
+                else{
+                    generations[slot_index] = invalid_index;
+                }
+            }
+
+            // Count neighbors of each slot, then scatter each pair into both lists.
+            offsets.assign(slot_count + 1, 0);
+            build_pairs.clear();
+            grid.queryDistancePairHandles(radius + skin, [&](BodyHandle handle1, BodyHandle handle2){
+                build_pairs.push_back({ handle1.index, handle2.index });
+                ++offsets[handle1.index + 1];
+                ++offsets[handle2.index + 1];
+            });
+            for (std::size_t slot_index = 0; slot_index < slot_count; ++slot_index){
+                offsets[slot_index + 1] += offsets[slot_index];
+            }
+
+            neighbors.resize(offsets.back());
+            build_cursors.assign(offsets.begin(), offsets.end() - 1);
+            for (const auto [slot1, slot2] : build_pairs){
+                neighbors[build_cursors[slot1]++] = slot2;
+                neighbors[build_cursors[slot2]++] = slot1;
+            }
+
+            ++build_count;
+        }
+
+        /**
+         * @brief Check if lists no longer cover all pairs within radius, because a body has moved more than skin / 2
+         * since the last build, or bodies are added to or removed from \p grid.
+         *
+         * @param grid Grid of bodies.
+         * @return true if lists have to be rebuilt, false otherwise.
+         */
+        [[nodiscard]] bool needsRebuild(const grid_t &grid) const{
+            const auto slot_count = grid.getSlotCount();
+            if (slot_count != generations.size()){
+                return true;
+            }
+
+            const auto half_skin_square = skin * skin / 4;
+            for (index_t slot_index = 0; slot_index < slot_count; ++slot_index){
+                const auto handle = grid.getBodyHandle(slot_index);
+                const auto generation = grid.contains(handle) ? handle.generation : invalid_index;
+                if (generation != generations[slot_index]){
+                    return true;
+                }
+
+                if (generation != invalid_index){
+                    const auto delta = displacement(grid, Vector2<T> { xs[slot_index], ys[slot_index] }, PositionGetter()(grid.getBody(handle)));
+                    if (delta.dot(delta) > half_skin_square){
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Rebuild lists if \p needsRebuild. It should be called once per step before queries.
+         *
+         * @param grid Grid of bodies, whose cells and cached positions are up to date.
+         * @return true if lists are rebuilt, false otherwise.
+         */
+        bool update(const grid_t &grid){
+            if (needsRebuild(grid)){
+                build(grid);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Get how many times lists have been built.
+         * @return Number of builds.
+         */
+        [[nodiscard]] std::size_t getBuildCount() const noexcept{
+            return build_count;
+        }
+
+        /**
+         * @brief Get slot indices of bodies that were within radius + skin from body of \p handle at the last build.
+         *
+         * @param handle Handle of body.
+         * @return Span of slot indices. Handle of each one is \p grid.getBodyHandle(index).
+         * @throw std::out_of_range If body of \p handle was not in the last build in debug mode.
+         */
+        std::span<const index_t> getNeighbors(BodyHandle handle) const NOEXCEPT_IF_RELEASE{
+#ifndef NDEBUG
+            if (handle.index >= generations.size() || generations[handle.index] != handle.generation) {
+                utils::throwOutOfRange("NeighborList::getNeighbors: body is not in the last build");
+            }
+#endif
+            return std::span { neighbors }.subspan(offsets[handle.index], offsets[handle.index + 1] - offsets[handle.index]);
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body that distance from body of \p handle is less than \p radius, at the
+         * current positions.
+         *
+         * @param grid Grid of bodies, which lists are up to date for.
+         * @param handle Handle of body to query.
+         * @param visitor Function to be invoked with reference of each nearby body.
+         * @throw std::out_of_range If body of \p handle was not in the last build in debug mode.
+         */
+        template <std::invocable<Body&> Visitor>
+        void queryDistance(const grid_t &grid, BodyHandle handle, Visitor &&visitor) const{
+            const auto position = PositionGetter()(grid.getBody(handle));
+            const auto radius_square = radius * radius;
+            for (const auto other : getNeighbors(handle)){
+                const auto delta = displacement(grid, position, currentPosition(grid, other));
+                if (delta.dot(delta) <= radius_square){
+                    visitor(grid.getBody(grid.getBodyHandle(other)));
+                }
+            }
+        }
+
+        /**
+         * @brief Invoke \p visitor with each body pair that distance between them is less than \p radius, at the
+         * current positions.
+         *
+         * Each pair is visited exactly once, in either order.
+         *
+         * @param grid Grid of bodies, which lists are up to date for.
+         * @param visitor Function to be invoked with references of both bodies of each pair.
+         */
+        template <std::invocable<Body&, Body&> Visitor>
+        void queryDistancePair(const grid_t &grid, Visitor &&visitor) const{
+            const auto radius_square = radius * radius;
+            for (index_t slot_index = 0; slot_index < generations.size(); ++slot_index){
+                if (generations[slot_index] == invalid_index){
+                    continue;
+                }
+
+                auto &body = grid.getBody(grid.getBodyHandle(slot_index));
+                const auto position = PositionGetter()(body);
+                for (auto offset = offsets[slot_index]; offset < offsets[slot_index + 1]; ++offset){
+                    const auto other = neighbors[offset];
+                    if (other < slot_index){ // Pair is visited from the body of the lower slot.
+                        continue;
+                    }
+
+                    auto &other_body = grid.getBody(grid.getBodyHandle(other));
+                    const auto delta = displacement(grid, position, PositionGetter()(other_body));
+                    if (delta.dot(delta) <= radius_square){
+                        visitor(body, other_body);
+                    }
+                }
+            }
+        }
+    };
+};
+
+#endif //SPATIAL_NEIGHBOR_LIST_HPP
@@ -0,0 +1,120 @@
+#ifndef SPATIAL_CELL_COVER_HPP
+#define SPATIAL_CELL_COVER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+
+#include "../rect.hpp"
+
+namespace spatial::utils{
+    /**
+     * @brief Invoke \p func with each cell row of a uniform grid that intersects the circle, and the column range of
+     * the row's cells that intersect it.
+     *
+     * For each row, the column range is narrowed by the chord of the circle at the row's nearest y, so that cells
+     * whose nearest point is outside the circle are skipped, and the remaining cells of a row are contiguous. Rows
+     * and columns outside the grid are clipped.
+     *
+     * @param bound Bound of grid.
+     * @param rows Number of rows.
+     * @param columns Number of columns.
+     * @param center Center of circle.
+     * @param distance Radius of circle.
+     * @param func Function to be invoked as func(row, col_begin, col_end), in ascending row order.
+     */
+    template <std::floating_point T, typename F>
+    void forEachCoveringRow(const Rect<T> &bound, std::size_t rows, std::size_t columns, const Vector2<T> &center, T distance, F &&func){
+        const auto cell_size = bound.size.cwiseDiv(Vector2<T> { static_cast<T>(columns), static_cast<T>(rows) });
+        const auto relative_center = center - bound.position;
+
+        if (relative_center.y + distance < 0 || relative_center.y - distance > bound.size.y){
+            return;
+        }
+
+        // Clamp in floating point domain first, so that huge distance does not overflow the cast.
+        const auto to_index = [](T value, std::size_t count){
+            return static_cast<std::size_t>(std::clamp(std::floor(value), T { 0 }, static_cast<T>(count - 1)));
+        };
+
+        const auto row_first = to_index((relative_center.y - distance) / cell_size.y, rows);
+        const auto row_last = to_index((relative_center.y + distance) / cell_size.y, rows);
+        for (auto row = row_first; row <= row_last; ++row){
+            const auto row_top = static_cast<T>(row) * cell_size.y;
+            const auto dy = std::max({ row_top - relative_center.y, relative_center.y - (row_top + cell_size.y), T { 0 } });
+            const auto half_chord = std::sqrt(std::max(distance * distance - dy * dy, T { 0 }));
+            if (relative_center.x + half_chord < 0 || relative_center.x - half_chord > bound.size.x){
+                continue;
+            }
+
+            const auto col_first = to_index((relative_center.x - half_chord) / cell_size.x, columns);
+            const auto col_last = to_index((relative_center.x + half_chord) / cell_size.x, columns);
+            func(row, col_first, col_last + 1);
+        }
+    }
+
+    /**
+     * @brief Invoke \p func with each cell row of an unbounded uniform grid that intersects the circle, and the column
+     * range of the row's cells that intersect it.
+     *
+     * Same as \p forEachCoveringRow, but rows and columns are not clipped, so they may be negative or beyond the
+     * number of rows or columns. Periodic grids map them to images of their cells.
+     *
+     * @param cell_size Size of cell.
+     * @param relative_center Center of circle, relative to the origin of grid.
+     * @param distance Radius of circle.
+     * @param func Function to be invoked as func(row, col_begin, col_end), in ascending row order.
+     */
+    template <std::floating_point T, typename F>
+    void forEachCoveringRowUnclipped(const Vector2<T> &cell_size, const Vector2<T> &relative_center, T distance, F &&func){
+        const auto to_index = [](T value){
+            return static_cast<std::ptrdiff_t>(std::floor(value));
+        };
+
+        const auto row_first = to_index((relative_center.y - distance) / cell_size.y);
+        const auto row_last = to_index((relative_center.y + distance) / cell_size.y);
+        for (auto row = row_first; row <= row_last; ++row){
+            const auto row_top = static_cast<T>(row) * cell_size.y;
+            const auto dy = std::max({ row_top - relative_center.y, relative_center.y - (row_top + cell_size.y), T { 0 } });
+            const auto half_chord = std::sqrt(std::max(distance * distance - dy * dy, T { 0 }));
+
+            const auto col_first = to_index((relative_center.x - half_chord) / cell_size.x);
+            const auto col_last = to_index((relative_center.x + half_chord) / cell_size.x);
+            func(row, col_first, col_last + 1);
+        }
+    }
+
+    /**
+     * @brief Get how many rows apart two cells can be while still having a point pair within \p distance.
+     *
+     * @param cell_size Size of cell.
+     * @param distance Distance between points.
+     * @param rows Number of rows. The result is clamped to it.
+     * @return Maximum row offset.
+     */
+    template <std::floating_point T>
+    std::size_t rowReach(const Vector2<T> &cell_size, T distance, std::size_t rows) noexcept{
+        // Cells k rows apart are separated by (k - 1) cell heights.
+        return static_cast<std::size_t>(std::min(std::floor(distance / cell_size.y) + 1, static_cast<T>(rows)));
+    }
+
+    /**
+     * @brief Get how many columns apart two cells that are \p row_offset rows apart can be while still having a point
+     * pair within \p distance.
+     *
+     * @param cell_size Size of cell.
+     * @param distance Distance between points.
+     * @param row_offset Row offset between cells, which must not exceed \p rowReach.
+     * @param columns Number of columns. The result is clamped to it.
+     * @return Maximum column offset.
+     */
+    template <std::floating_point T>
+    std::size_t columnReach(const Vector2<T> &cell_size, T distance, std::size_t row_offset, std::size_t columns) noexcept{
+        const auto gap_y = static_cast<T>(row_offset == 0 ? 0 : row_offset - 1) * cell_size.y;
+        const auto remaining = std::sqrt(std::max(distance * distance - gap_y * gap_y, T { 0 }));
+        return static_cast<std::size_t>(std::min(std::floor(remaining / cell_size.x) + 1, static_cast<T>(columns)));
+    }
+};
+
+#endif //SPATIAL_CELL_COVER_HPP
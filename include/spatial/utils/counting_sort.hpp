@@ -0,0 +1,93 @@
+#ifndef SPATIAL_COUNTING_SORT_HPP
+#define SPATIAL_COUNTING_SORT_HPP
+
+#include <algorithm>
+#include <barrier>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace spatial::utils{
+    /**
+     * @brief Scratch buffers of \p countingSort. Reuse them across calls to avoid allocation.
+     */
+    struct CountingSortBuffers{
+        std::vector<std::uint32_t> histograms; // Per-thread histograms, which become per-thread cursors.
+        std::vector<std::uint32_t> range_offsets; // Start offset of each thread's bucket range.
+    };
+
+    /**
+     * @brief Stable counting sort of element indices by their bucket, using multiple threads.
+     *
+     * Elements are split into contiguous chunks, one per thread. Each thread counts its chunk into its own histogram,
+     * histograms are prefix-summed in (bucket, thread) order, and each thread scatters its chunk using its own
+     * cursors. Therefore, the result does not depend on \p num_threads and is same as the single threaded sort.
+     *
+     * Histograms take (threads * buckets) entries, so threads are limited to (elements / buckets). Otherwise zeroing
+     * and summing histograms would cost more than the sort itself when there are far more buckets than elements. All
+     * phases run on one set of threads, separated by a barrier.
+     *
+     * @param buckets Bucket of each element, in [0, \p bucket_offsets.size() - 1).
+     * @param bucket_offsets Output start offset of each bucket in \p order, followed by the number of elements.
+     * @param order Output indices of elements sorted by their bucket. Must have same size as \p buckets.
+     * @param buffers Scratch buffers.
+     * @param num_threads Maximum number of threads to use.
+     */
+    inline void countingSort(std::span<const std::uint32_t> buckets, std::span<std::uint32_t> bucket_offsets, std::span<std::uint32_t> order,
+                             CountingSortBuffers &buffers, std::size_t num_threads = 1){
+        const auto bucket_count = bucket_offsets.size() - 1;
+        const auto thread_count = std::clamp<std::size_t>(num_threads, 1, std::max<std::size_t>(buckets.size() / std::max<std::size_t>(bucket_count, 1), 1));
+        auto &histograms = buffers.histograms;
+        auto &range_offsets = buffers.range_offsets;
+        histograms.assign(thread_count * bucket_count, 0);
+        range_offsets.assign(thread_count + 1, 0);
+
+        std::barrier sync { static_cast<std::ptrdiff_t>(thread_count) };
+        parallelInvoke(thread_count, [&](std::size_t thread_index){
+            const auto [element_begin, element_end] = chunkRange(buckets.size(), thread_count, thread_index);
+            const auto [bucket_begin, bucket_end] = chunkRange(bucket_count, thread_count, thread_index);
+
+            // Count elements of the chunk.
+            auto *histogram = histograms.data() + thread_index * bucket_count;
+            for (auto i = element_begin; i < element_end; ++i){
+                ++histogram[buckets[i]];
+            }
+            sync.arrive_and_wait();
+
+            // Sum counts of the bucket range, ...
+            std::uint32_t sum = 0;
+            for (auto bucket = bucket_begin; bucket < bucket_end; ++bucket){
+                for (std::size_t t = 0; t < thread_count; ++t){
+                    sum += histograms[t * bucket_count + bucket];
+                }
+            }
+            range_offsets[thread_index + 1] = sum;
+            sync.arrive_and_wait();
+
+            // ... and turn the histograms into per-thread cursors, in (bucket, thread) order.
+            auto offset = std::accumulate(range_offsets.begin(), range_offsets.begin() + static_cast<std::ptrdiff_t>(thread_index + 1), std::uint32_t { 0 });
+            for (auto bucket = bucket_begin; bucket < bucket_end; ++bucket){
+                bucket_offsets[bucket] = offset;
+                for (std::size_t t = 0; t < thread_count; ++t){
+                    auto &cursor = histograms[t * bucket_count + bucket];
+                    const auto count = cursor;
+                    cursor = offset;
+                    offset += count;
+                }
+            }
+            sync.arrive_and_wait();
+
+            // Scatter.
+            for (auto i = element_begin; i < element_end; ++i){
+                order[histogram[buckets[i]]++] = static_cast<std::uint32_t>(i);
+            }
+        });
+        bucket_offsets[bucket_count] = static_cast<std::uint32_t>(buckets.size());
+    }
+};
+
+#endif //SPATIAL_COUNTING_SORT_HPP
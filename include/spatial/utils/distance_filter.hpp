@@ -0,0 +1,142 @@
+#ifndef SPATIAL_DISTANCE_FILTER_HPP
+#define SPATIAL_DISTANCE_FILTER_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__AVX__)
+#define SPATIAL_SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPATIAL_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace spatial::utils{
+    namespace details{
+        /**
+         * @brief Append \p base + (index of each set bit of \p mask) to \p out.
+         */
+        inline std::size_t compactMask(unsigned mask, std::size_t base, std::uint32_t *out, std::size_t hit_count) noexcept{
+            while (mask != 0){
+                out[hit_count++] = static_cast<std::uint32_t>(base + std::countr_zero(mask));
+                mask &= mask - 1;
+            }
+            return hit_count;
+        }
+    };
+
+    /**
+     * @brief Find points within distance from center.
+     *
+     * Points are given in structure-of-arrays form. They are tested 8 (AVX) or 4 (SSE2) floats at a time, or one by one
+     * if neither is enabled at compile time.
+     *
+     * @param xs x positions of points.
+     * @param ys y positions of points.
+     * @param count Number of points.
+     * @param center_x x position of center.
+     * @param center_y y position of center.
+     * @param distance_square Square of distance.
+     * @param out Output buffer for indices of points within distance. It must have space for \p count elements.
+     * @return Number of indices written to \p out.
+     */
+    template <std::floating_point T>
+    std::size_t filterWithinDistance(const T *xs, const T *ys, std::size_t count, T center_x, T center_y, T distance_square, std::uint32_t *out) noexcept{
+        std::size_t hit_count = 0;
+        std::size_t i = 0;
+
+#if defined(SPATIAL_SIMD_AVX)
+        if constexpr (std::is_same_v<T, float>){
+            const auto cx = _mm256_set1_ps(center_x);
+            const auto cy = _mm256_set1_ps(center_y);
+            const auto r2 = _mm256_set1_ps(distance_square);
+            for (; i + 8 <= count; i += 8){
+                const auto dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), cx);
+                const auto dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), cy);
+                const auto d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+                const auto mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ)));
+                hit_count = details::compactMask(mask, i, out, hit_count);
+            }
+        }
+        else if constexpr (std::is_same_v<T, double>){
+            const auto cx = _mm256_set1_pd(center_x);
+            const auto cy = _mm256_set1_pd(center_y);
+            const auto r2 = _mm256_set1_pd(distance_square);
+            for (; i + 4 <= count; i += 4){
+                const auto dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), cx);
+                const auto dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), cy);
+                const auto d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+                const auto mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(d2, r2, _CMP_LE_OQ)));
+                hit_count = details::compactMask(mask, i, out, hit_count);
+            }
+        }
+#elif defined(SPATIAL_SIMD_SSE2)
+        if constexpr (std::is_same_v<T, float>){
+            const auto cx = _mm_set1_ps(center_x);
+            const auto cy = _mm_set1_ps(center_y);
+            const auto r2 = _mm_set1_ps(distance_square);
+            for (; i + 4 <= count; i += 4){
+                const auto dx = _mm_sub_ps(_mm_loadu_ps(xs + i), cx);
+                const auto dy = _mm_sub_ps(_mm_loadu_ps(ys + i), cy);
+                const auto d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+                const auto mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(d2, r2)));
+                hit_count = details::compactMask(mask, i, out, hit_count);
+            }
+        }
+        else if constexpr (std::is_same_v<T, double>){
+            const auto cx = _mm_set1_pd(center_x);
+            const auto cy = _mm_set1_pd(center_y);
+            const auto r2 = _mm_set1_pd(distance_square);
+            for (; i + 2 <= count; i += 2){
+                const auto dx = _mm_sub_pd(_mm_loadu_pd(xs + i), cx);
+                const auto dy = _mm_sub_pd(_mm_loadu_pd(ys + i), cy);
+                const auto d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+                const auto mask = static_cast<unsigned>(_mm_movemask_pd(_mm_cmple_pd(d2, r2)));
+                hit_count = details::compactMask(mask, i, out, hit_count);
+            }
+        }
+#endif
+
+        // Remainder (or everything, if no SIMD is available). Branchless: always write, advance only on hit.
+        for (; i < count; ++i){
+            const auto dx = xs[i] - center_x;
+            const auto dy = ys[i] - center_y;
+            out[hit_count] = static_cast<std::uint32_t>(i);
+            hit_count += dx * dx + dy * dy <= distance_square;
+        }
+
+        return hit_count;
+    }
+
+    /**
+     * @brief Invoke \p func with index of each point within distance from center, in ascending order.
+     *
+     * Points are filtered by \p filterWithinDistance in fixed size chunks, so it does not allocate.
+     *
+     * @param xs x positions of points.
+     * @param ys y positions of points. Must have the same size as \p xs.
+     * @param center_x x position of center.
+     * @param center_y y position of center.
+     * @param distance_square Square of distance.
+     * @param func Function to be invoked with index of point.
+     */
+    template <std::floating_point T, typename F>
+    void forEachWithinDistance(std::span<const T> xs, std::span<const T> ys, T center_x, T center_y, T distance_square, F &&func){
+        std::array<std::uint32_t, 256> hits;
+        for (std::size_t first = 0; first < xs.size(); first += hits.size()){
+            const auto count = std::min(hits.size(), xs.size() - first);
+            const auto hit_count = filterWithinDistance(xs.data() + first, ys.data() + first, count, center_x, center_y, distance_square, hits.data());
+            for (std::size_t k = 0; k < hit_count; ++k){
+                func(first + hits[k]);
+            }
+        }
+    }
+};
+
+#endif //SPATIAL_DISTANCE_FILTER_HPP
@@ -11,4 +11,11 @@
 #define NOEXCEPT_IF_RELEASE noexcept
 #endif
 
+// Statements that only record statistics. They are compiled out unless SPATIAL_ENABLE_STATS is defined.
+#ifdef SPATIAL_ENABLE_STATS
+#define SPATIAL_STATS(...) __VA_ARGS__
+#else
+#define SPATIAL_STATS(...)
+#endif
+
 #endif //SPATIAL_MACROS_HPP
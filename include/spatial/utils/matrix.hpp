@@ -5,34 +5,141 @@
 #ifndef SPATIAL_MATRIX_HPP
 #define SPATIAL_MATRIX_HPP
 
+#include <algorithm>
+#include <bit>
+#include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <utility>
 
+#include "space_filling_curve.hpp"
 #include "thrower.hpp"
 
 namespace spatial::utils{
-    template <typename T>
-    class Matrix{
+    /**
+     * @brief Mapping from 2D index (row, column) to offset in the storage of a \p Matrix, constructed from the number of
+     * rows and columns. \p size is the number of elements to allocate, which may be larger than rows * columns.
+     */
+    template <typename Layout>
+    concept MatrixLayout = std::constructible_from<Layout, std::size_t, std::size_t> && requires(const Layout layout, std::size_t index){
+        { layout.size() } -> std::same_as<std::size_t>;
+        { layout(index, index) } -> std::same_as<std::size_t>;
+    };
+
+    /**
+     * @brief Row major layout. Horizontally adjacent elements are adjacent in memory, but vertically adjacent ones are
+     * a whole row apart.
+     */
+    class RowMajorLayout{
     private:
-        /////////////////////////
-        // Fields.
-        /////////////////////////
+        std::size_t rows;
+        std::size_t columns;
 
-        T *data;
+    public:
+        constexpr RowMajorLayout(std::size_t rows, std::size_t columns) noexcept : rows(rows), columns(columns) {}
+
+        [[nodiscard]] constexpr std::size_t size() const noexcept{
+            return rows * columns;
+        }
+
+        [[nodiscard]] constexpr std::size_t operator()(std::size_t row, std::size_t column) const noexcept{
+            return row * columns + column;
+        }
+    };
+
+    /**
+     * @brief Layout of square tiles of \p TileSize x \p TileSize elements, which are row major inside a tile and row
+     * major between tiles. A 3x3 neighborhood spans at most 4 tiles. Rows and columns are padded to a multiple of
+     * \p TileSize.
+     */
+    template <std::size_t TileSize = 8>
+    requires (std::has_single_bit(TileSize))
+    class TiledLayout{
+    private:
+        std::size_t tile_rows;
+        std::size_t tile_columns;
+
+    public:
+        constexpr TiledLayout(std::size_t rows, std::size_t columns) noexcept
+                : tile_rows((rows + TileSize - 1) / TileSize), tile_columns((columns + TileSize - 1) / TileSize) {}
+
+        [[nodiscard]] constexpr std::size_t size() const noexcept{
+            return tile_rows * tile_columns * TileSize * TileSize;
+        }
+
+        [[nodiscard]] constexpr std::size_t operator()(std::size_t row, std::size_t column) const noexcept{
+            const auto tile = (row / TileSize) * tile_columns + column / TileSize;
+            return (tile * TileSize + row % TileSize) * TileSize + column % TileSize;
+        }
+    };
+
+    /**
+     * @brief Z-order (Morton) layout, which interleaves bits of row and column, so that every aligned square block of
+     * 2^k x 2^k elements is contiguous in memory.
+     *
+     * Rows and columns are padded to powers of two. If they differ, the remaining high bits of the longer side are put
+     * above the interleaved bits, i.e. the matrix is a row or column of Z-ordered squares.
+     */
+    class MortonLayout{
+    private:
+        std::size_t interleaved_bits; // Number of low bits of row and column that are interleaved.
+        std::size_t capacity;
 
     public:
+        constexpr MortonLayout(std::size_t rows, std::size_t columns) noexcept
+                : interleaved_bits(static_cast<std::size_t>(std::countr_zero(std::bit_ceil(std::min(rows, columns))))),
+                  capacity(std::bit_ceil(rows) * std::bit_ceil(columns)) {}
+
+        [[nodiscard]] constexpr std::size_t size() const noexcept{
+            return capacity;
+        }
+
+        [[nodiscard]] constexpr std::size_t operator()(std::size_t row, std::size_t column) const noexcept{
+            const auto low_mask = (std::size_t { 1 } << interleaved_bits) - 1;
+            const auto interleaved = mortonKey(static_cast<std::uint32_t>(row & low_mask), static_cast<std::uint32_t>(column & low_mask));
+
+            // Only the longer side has bits above interleaved_bits.
+            return static_cast<std::size_t>(interleaved) | (((row | column) >> interleaved_bits) << (2 * interleaved_bits));
+        }
+    };
+
+    /**
+     * @brief 2D array of \p rows x \p columns elements, whose storage order is decided by \p Layout.
+     */
+    template <typename T, MatrixLayout Layout = RowMajorLayout>
+    class Matrix{
+    private:
         /////////////////////////
         // Fields.
         /////////////////////////
 
-        const std::size_t rows;
-        const std::size_t columns;
+        T *data;
+        std::size_t rows;
+        std::size_t columns;
+        Layout layout;
 
+    public:
         /////////////////////////
         // Constructors and destructor.
         /////////////////////////
 
-        constexpr Matrix(std::size_t rows, std::size_t columns) : rows(rows), columns(columns) {
-            data = new T[rows * columns];
+        constexpr Matrix(std::size_t rows, std::size_t columns) : rows(rows), columns(columns), layout(rows, columns) {
+            data = new T[layout.size()];
+        }
+
+        constexpr Matrix(Matrix &&other) noexcept
+                : data(std::exchange(other.data, nullptr)), rows(std::exchange(other.rows, 0)), columns(std::exchange(other.columns, 0)),
+                  layout(other.layout) {}
+
+        constexpr Matrix &operator=(Matrix &&other) noexcept{
+            if (this != &other){
+                delete[] data;
+                data = std::exchange(other.data, nullptr);
+                rows = std::exchange(other.rows, 0);
+                columns = std::exchange(other.columns, 0);
+                layout = other.layout;
+            }
+            return *this;
         }
 
         constexpr ~Matrix(){
@@ -43,12 +150,20 @@ namespace spatial::utils{
         // Methods.
         /////////////////////////
 
+        [[nodiscard]] constexpr std::size_t rowCount() const noexcept{
+            return rows;
+        }
+
+        [[nodiscard]] constexpr std::size_t columnCount() const noexcept{
+            return columns;
+        }
+
         constexpr T &operator()(std::size_t row, std::size_t column) noexcept{
-            return data[row * columns + column];
+            return data[layout(row, column)];
         }
 
         constexpr const T &operator()(std::size_t row, std::size_t column) const noexcept{
-            return data[row * columns + column];
+            return data[layout(row, column)];
         }
 
         constexpr T &at(std::size_t row, std::size_t column) {
@@ -56,7 +171,7 @@ namespace spatial::utils{
                 utils::throwOutOfRange("Matrix::at");
             }
 
-            return data[row * columns + column];
+            return data[layout(row, column)];
         }
 
         constexpr const T &at(std::size_t row, std::size_t column) const{
@@ -64,7 +179,7 @@ namespace spatial::utils{
                 utils::throwOutOfRange("Matrix::at");
             }
 
-            return data[row * columns + column];
+            return data[layout(row, column)];
         }
 
 //        /**
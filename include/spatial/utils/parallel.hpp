@@ -0,0 +1,69 @@
+#ifndef SPATIAL_PARALLEL_HPP
+#define SPATIAL_PARALLEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace spatial::utils{
+    /**
+     * @brief Get default number of threads for parallel operations.
+     * @return Number of hardware threads, or 1 if it cannot be determined.
+     */
+    inline std::size_t defaultThreadCount() noexcept{
+        return std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    /**
+     * @brief Invoke \p func concurrently on \p num_threads threads, as func(thread_index).
+     *
+     * The calling thread runs thread index 0. It returns after all invocations return. Phases that depend on each
+     * other can be separated by a \p std::barrier of \p num_threads inside \p func, instead of spawning threads for
+     * each phase.
+     *
+     * @param num_threads Number of threads to use. At least 1.
+     * @param func Function to run on each thread. It must not throw.
+     */
+    template <typename F>
+    void parallelInvoke(std::size_t num_threads, F &&func){
+        std::vector<std::jthread> workers;
+        workers.reserve(num_threads - 1);
+        for (std::size_t thread_index = 1; thread_index < num_threads; ++thread_index){
+            workers.emplace_back([&, thread_index]{
+                func(thread_index);
+            });
+        }
+
+        func(std::size_t { 0 });
+    }
+
+    /**
+     * @brief Get the \p thread_index -th of \p num_threads contiguous chunks of [0, \p count), as [begin, end).
+     */
+    constexpr std::array<std::size_t, 2> chunkRange(std::size_t count, std::size_t num_threads, std::size_t thread_index) noexcept{
+        return { count * thread_index / num_threads, count * (thread_index + 1) / num_threads };
+    }
+
+    /**
+     * @brief Split [0, \p count) into \p num_threads contiguous chunks and process them concurrently.
+     *
+     * \p func is invoked as func(begin, end, thread_index) once per chunk. Chunks are ordered by thread index, and
+     * the calling thread processes the first one. It returns after all chunks are processed.
+     *
+     * @param count Number of elements to process.
+     * @param num_threads Number of threads to use. It is clamped into [1, \p count].
+     * @param func Function to process a chunk. It must not throw.
+     */
+    template <typename F>
+    void parallelFor(std::size_t count, std::size_t num_threads, F &&func){
+        num_threads = std::clamp<std::size_t>(num_threads, 1, std::max<std::size_t>(count, 1));
+        parallelInvoke(num_threads, [&](std::size_t thread_index){
+            const auto [begin, end] = chunkRange(count, num_threads, thread_index);
+            func(begin, end, thread_index);
+        });
+    }
+};
+
+#endif //SPATIAL_PARALLEL_HPP
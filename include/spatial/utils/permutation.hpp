@@ -0,0 +1,45 @@
+#ifndef SPATIAL_PERMUTATION_HPP
+#define SPATIAL_PERMUTATION_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+#include "thrower.hpp"
+
+namespace spatial::utils{
+    /**
+     * @brief Reorder every range of \p ranges by \p order, so that the k-th element becomes the element previously at
+     * index order[k]. Ranges are columns of a structure of arrays, which are reordered the same way.
+     *
+     * Each range is gathered into a temporary buffer and moved back, so \p order must be a permutation of
+     * [0, size of ranges).
+     *
+     * @param order Permutation of indices, e.g. from \p Grid::getSpatialOrder with \p IndexBodyStorage.
+     * @param ranges Ranges to reorder, whose sizes are same as \p order.
+     * @throw std::invalid_argument If size of any range differs from size of \p order in debug mode.
+     */
+    template <std::ranges::random_access_range Order, std::ranges::random_access_range... Ranges>
+    requires std::integral<std::ranges::range_value_t<Order>>
+    void applyPermutation(const Order &order, Ranges &&...ranges){
+#ifndef NDEBUG
+        if (((std::ranges::size(ranges) != std::ranges::size(order)) || ...)) {
+            throwInvalidArgument("applyPermutation: sizes of ranges must be same as size of order");
+        }
+#endif
+
+        const auto apply = [&](auto &&range){
+            std::vector<std::ranges::range_value_t<decltype(range)>> buffer;
+            buffer.reserve(std::ranges::size(order));
+            for (const auto index : order){
+                buffer.push_back(std::move(std::ranges::begin(range)[index]));
+            }
+            std::ranges::move(buffer, std::ranges::begin(range));
+        };
+        (apply(ranges), ...);
+    }
+};
+
+#endif //SPATIAL_PERMUTATION_HPP
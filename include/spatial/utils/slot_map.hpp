@@ -0,0 +1,199 @@
+#ifndef SPATIAL_SLOT_MAP_HPP
+#define SPATIAL_SLOT_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace spatial::utils{
+    /**
+     * @brief Stable handle of an element in \p SlotMap.
+     *
+     * It stays valid until the element is erased. Slots of erased elements are reused with an increased generation, so
+     * a stale handle never refers to another element.
+     */
+    struct SlotHandle{
+        std::uint32_t index;
+        std::uint32_t generation;
+
+        bool operator==(const SlotHandle&) const noexcept = default;
+    };
+
+    /**
+     * @brief Array of \p Slot addressed by generational handles, reusing the slots of erased elements.
+     *
+     * Slot indices are dense and stable while their elements live, so owners can store them in their own structures
+     * (e.g. the cells of a grid) and index the slots with them directly. An erased slot is reset to \p Slot{} and put in
+     * a free list, which the next insertion takes from.
+     */
+    template <typename Slot>
+    class SlotMap{
+    public:
+        using index_t = std::uint32_t;
+
+    private:
+        struct Entry{
+            Slot value {};
+            index_t generation = 0;
+            bool alive = false;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<index_t> free_indices;
+        std::size_t alive_count = 0;
+
+    public:
+        /**
+         * @brief Get number of live elements.
+         * @return Number of live elements.
+         */
+        [[nodiscard]] std::size_t size() const noexcept{
+            return alive_count;
+        }
+
+        /**
+         * @brief Check if there is no live element.
+         * @return true if there is no live element, false otherwise.
+         */
+        [[nodiscard]] bool empty() const noexcept{
+            return alive_count == 0;
+        }
+
+        /**
+         * @brief Get number of slots. Index of every handle is less than it.
+         * @return Number of slots, including free ones.
+         */
+        [[nodiscard]] std::size_t slotCount() const noexcept{
+            return entries.size();
+        }
+
+        /**
+         * @brief Check if \p handle refers to a live element.
+         *
+         * @param handle Handle to check.
+         * @return true if element of \p handle is not erased, false otherwise.
+         */
+        [[nodiscard]] bool contains(SlotHandle handle) const noexcept{
+            return handle.index < entries.size() &&
+                   entries[handle.index].generation == handle.generation &&
+                   entries[handle.index].alive;
+        }
+
+        /**
+         * @brief Check if slot \p index holds a live element.
+         *
+         * @param index Slot index, which must be less than \p slotCount().
+         * @return true if slot is not free, false otherwise.
+         */
+        [[nodiscard]] bool isAlive(index_t index) const noexcept{
+            return entries[index].alive;
+        }
+
+        /**
+         * @brief Get handle of the element in slot \p index.
+         *
+         * @param index Slot index, which must be less than \p slotCount().
+         * @return Handle of the element with the current generation of slot.
+         */
+        [[nodiscard]] SlotHandle handle(index_t index) const noexcept{
+            return { index, entries[index].generation };
+        }
+
+        Slot &operator[](index_t index) noexcept{
+            return entries[index].value;
+        }
+
+        const Slot &operator[](index_t index) const noexcept{
+            return entries[index].value;
+        }
+
+        /**
+         * @brief Put \p value in a free slot, or a new slot if there is none.
+         *
+         * @param value Element to insert.
+         * @return Handle of inserted element.
+         */
+        SlotHandle insert(Slot value = {}){
+            index_t index;
+            if (free_indices.empty()){
+                index = static_cast<index_t>(entries.size());
+                entries.emplace_back();
+            }
+            else{
+                index = free_indices.back();
+                free_indices.pop_back();
+            }
+
+            auto &entry = entries[index];
+            entry.value = std::move(value);
+            entry.alive = true;
+            ++alive_count;
+
+            return { index, entry.generation };
+        }
+
+        /**
+         * @brief Erase element of \p handle, resetting its slot and increasing its generation.
+         *
+         * @param handle Handle of element to erase. It is invalidated.
+         * @return true if element is erased, false if \p handle was not valid.
+         */
+        bool erase(SlotHandle handle) noexcept{
+            if (!contains(handle)){
+                return false;
+            }
+
+            auto &entry = entries[handle.index];
+            entry.value = Slot {};
+            entry.alive = false;
+            ++entry.generation;
+            free_indices.push_back(handle.index);
+            --alive_count;
+
+            return true;
+        }
+
+        /**
+         * @brief Erase all elements. All handles are invalidated, and slots are kept to be reused.
+         */
+        void clear() noexcept{
+            free_indices.clear();
+            for (index_t index = 0; index < entries.size(); ++index){
+                auto &entry = entries[index];
+                if (entry.alive){
+                    entry.value = Slot {};
+                    entry.alive = false;
+                    ++entry.generation;
+                }
+                free_indices.push_back(index);
+            }
+            alive_count = 0;
+        }
+
+        /**
+         * @brief Invalidate all handles, and make slots [0, \p count) hold live default elements.
+         *
+         * It is for owners that fill slots in bulk, where the i-th element goes to slot i.
+         *
+         * @param count Number of live elements.
+         */
+        void reset(std::size_t count){
+            entries.resize(std::max(entries.size(), count));
+            free_indices.clear();
+            for (auto index = static_cast<index_t>(entries.size()); index-- > 0;){
+                auto &entry = entries[index];
+                entry.value = Slot {};
+                entry.alive = index < count;
+                ++entry.generation;
+                if (!entry.alive){
+                    free_indices.push_back(index);
+                }
+            }
+            alive_count = count;
+        }
+    };
+};
+
+#endif //SPATIAL_SLOT_MAP_HPP
@@ -0,0 +1,65 @@
+#ifndef SPATIAL_SPACE_FILLING_CURVE_HPP
+#define SPATIAL_SPACE_FILLING_CURVE_HPP
+
+#include <cstdint>
+#include <utility>
+
+namespace spatial::utils{
+    /**
+     * @brief Spread lower 32 bits of \p value to even bits.
+     */
+    constexpr std::uint64_t spreadBits(std::uint64_t value) noexcept{
+        value &= 0x00000000FFFFFFFF;
+        value = (value | (value << 16)) & 0x0000FFFF0000FFFF;
+        value = (value | (value << 8)) & 0x00FF00FF00FF00FF;
+        value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0F;
+        value = (value | (value << 2)) & 0x3333333333333333;
+        value = (value | (value << 1)) & 0x5555555555555555;
+        return value;
+    }
+
+    /**
+     * @brief Get position of (\p row, \p column) along Z-order (Morton) curve, by interleaving their bits.
+     *
+     * @param row Row of cell.
+     * @param column Column of cell.
+     * @return Morton key, whose odd bits are of \p row and even bits are of \p column.
+     */
+    constexpr std::uint64_t mortonKey(std::uint32_t row, std::uint32_t column) noexcept{
+        return (spreadBits(row) << 1) | spreadBits(column);
+    }
+
+    /**
+     * @brief Get position of (\p row, \p column) along Hilbert curve that fills a square of 2^\p order x 2^\p order
+     * cells.
+     *
+     * Unlike Z-order, consecutive cells along Hilbert curve are always adjacent, so it keeps spatial neighbors closer
+     * in the order, at the cost of a loop over \p order.
+     *
+     * @param order Number of bits of row and column, in [0, 32].
+     * @param row Row of cell, less than 2^\p order.
+     * @param column Column of cell, less than 2^\p order.
+     * @return Hilbert key, less than 4^\p order.
+     */
+    constexpr std::uint64_t hilbertKey(unsigned order, std::uint32_t row, std::uint32_t column) noexcept{
+        std::uint64_t key = 0;
+        for (auto bit = order; bit-- > 0;){
+            const std::uint32_t row_bit = (row >> bit) & 1;
+            const std::uint32_t column_bit = (column >> bit) & 1;
+            key |= static_cast<std::uint64_t>((3 * column_bit) ^ row_bit) << (2 * bit);
+
+            // Rotate the quadrant so that the curve inside it starts and ends at the right corners.
+            if (row_bit == 0){
+                if (column_bit == 1){
+                    const auto mask = (std::uint32_t { 1 } << bit) - 1;
+                    row = ~row & mask;
+                    column = ~column & mask;
+                }
+                std::swap(row, column);
+            }
+        }
+        return key;
+    }
+};
+
+#endif //SPATIAL_SPACE_FILLING_CURVE_HPP
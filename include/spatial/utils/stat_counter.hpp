@@ -0,0 +1,36 @@
+#ifndef SPATIAL_STAT_COUNTER_HPP
+#define SPATIAL_STAT_COUNTER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace spatial::utils{
+    /**
+     * @brief Counter of statistics that can be added from multiple threads.
+     *
+     * Additions are relaxed, as counters are only read after the counted operations. Unlike \p std::atomic, it is
+     * movable, so that classes holding it remain movable.
+     */
+    class StatCounter{
+    private:
+        std::atomic<std::uint64_t> value { 0 };
+
+    public:
+        StatCounter() noexcept = default;
+        StatCounter(StatCounter &&other) noexcept : value(other.load()) {}
+
+        void add(std::uint64_t amount) noexcept{
+            value.fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] std::uint64_t load() const noexcept{
+            return value.load(std::memory_order_relaxed);
+        }
+
+        void reset() noexcept{
+            value.store(0, std::memory_order_relaxed);
+        }
+    };
+};
+
+#endif //SPATIAL_STAT_COUNTER_HPP
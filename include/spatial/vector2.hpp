@@ -102,7 +102,9 @@ namespace spatial{
          * @note It is more efficient than \p distance. Use this if you can.
          */
         constexpr T distance2(const Vector2 &other) const noexcept {
-            return std::pow(other.x - x, 2) + std::pow(other.y - y, 2);
+            const auto dx = other.x - x;
+            const auto dy = other.y - y;
+            return dx * dx + dy * dy;
         }
     };
 
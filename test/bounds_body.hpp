@@ -0,0 +1,99 @@
+#ifndef SPATIAL_TEST_BOUNDS_BODY_HPP
+#define SPATIAL_TEST_BOUNDS_BODY_HPP
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include <spatial/rect.hpp>
+#include <boost/ut.hpp>
+
+/*
+ * Square body with extent, and brute-force checks of the overlap queries shared by ExtentGrid, LooseGrid and
+ * HierarchicalGrid.
+ */
+
+struct Body{
+public:
+    std::array<float, 2> position;
+    float half_size;
+};
+
+struct BodyBoundsGetter{
+    spatial::FloatRect operator()(const Body &body) const noexcept{
+        return { body.position[0] - body.half_size, body.position[1] - body.half_size,
+                 body.position[0] + body.half_size, body.position[1] + body.half_size };
+    }
+};
+
+inline bool overlaps(const spatial::FloatRect &a, const spatial::FloatRect &b){
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+inline bool overlaps(const Body &a, const Body &b){
+    return overlaps(BodyBoundsGetter()(a), BodyBoundsGetter()(b));
+}
+
+/**
+ * @brief Check pair, overlap and rectangle queries of \p grid against brute force over \p bodies.
+ *
+ * @param grid Grid whose bodies are exactly \p bodies, referred by pointers.
+ * @param bodies Bodies in grid.
+ * @param handles Handle of each body of \p bodies.
+ * @param rects Rectangles to query.
+ */
+template <typename Grid>
+void expectQueriesMatchBruteForce(const Grid &grid, const std::vector<Body*> &bodies, const std::vector<typename Grid::BodyHandle> &handles,
+                                  std::initializer_list<spatial::FloatRect> rects){
+    using namespace boost::ut;
+
+    std::size_t expected_pairs = 0;
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+            expected_pairs += overlaps(*bodies[i], *bodies[j]);
+        }
+    }
+
+    auto pairs = grid.queryOverlapPair();
+    for (auto &pair : pairs) {
+        expect(overlaps(*pair[0], *pair[1]));
+        std::ranges::sort(pair);
+    }
+    std::ranges::sort(pairs);
+    expect(pairs.size() == expected_pairs);
+    expect(std::ranges::adjacent_find(pairs) == pairs.end()); // Each pair appears once.
+
+    std::size_t visited_pairs = 0;
+    grid.queryOverlapPair([&](Body &body1, Body &body2){
+        expect(overlaps(body1, body2));
+        ++visited_pairs;
+    });
+    expect(visited_pairs == expected_pairs);
+
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        const auto expected = std::ranges::count_if(bodies, [&](const Body *other){
+            return other != bodies[i] && overlaps(*bodies[i], *other);
+        });
+        auto result = grid.queryOverlap(handles[i]);
+        std::ranges::sort(result);
+        expect(result.size() == static_cast<std::size_t>(expected));
+        expect(std::ranges::adjacent_find(result) == result.end());
+
+        std::size_t visited = 0;
+        grid.queryOverlap(handles[i], [&](Body&){ ++visited; });
+        expect(visited == static_cast<std::size_t>(expected));
+    }
+
+    for (const auto &rect : rects) {
+        const auto expected = std::ranges::count_if(bodies, [&](const Body *body){
+            return overlaps(rect, BodyBoundsGetter()(*body));
+        });
+        expect(grid.queryRect(rect).size() == static_cast<std::size_t>(expected));
+
+        std::size_t visited = 0;
+        grid.queryRect(rect, [&](Body&){ ++visited; });
+        expect(visited == static_cast<std::size_t>(expected));
+    }
+}
+
+#endif //SPATIAL_TEST_BOUNDS_BODY_HPP
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include <spatial/contact_tracker.hpp>
+#include <boost/ut.hpp>
+
+struct Body{
+public:
+    std::array<float, 2> position;
+};
+
+struct BodyPositionGetter{
+    spatial::Vector2f operator()(const Body &body) const noexcept{
+        return { body.position[0], body.position[1] };
+    }
+};
+
+using Grid = spatial::Grid<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>>;
+using ContactTracker = spatial::ContactTracker<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>>;
+
+int main(){
+    using namespace boost::ut;
+
+    "update"_test = []{
+        Grid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::vector<Body> bodies {
+            Body { { 10.f, 10.f } },
+            Body { { 12.f, 10.f } },
+            Body { { 30.f, 10.f } },
+        };
+        std::vector<Grid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+
+        ContactTracker tracker;
+        std::size_t begin_count = 0, end_count = 0;
+        const auto on_begin = [&](Grid::BodyHandle, Grid::BodyHandle){ ++begin_count; };
+        const auto on_end = [&](Grid::BodyHandle, Grid::BodyHandle){ ++end_count; };
+
+        tracker.update(grid, 3.f, on_begin, on_end);
+        expect(begin_count == 1_i);
+        expect(end_count == 0_i);
+        expect(tracker.isInContact(handles[1], handles[0]));
+        expect(!tracker.isInContact(handles[0], handles[2]));
+
+        // Staying contacts emit nothing.
+        tracker.update(grid, 3.f, on_begin, on_end);
+        expect(begin_count == 1_i);
+        expect(end_count == 0_i);
+        expect(tracker.getContacts().size() == 1_i);
+
+        bodies[2].position = { 14.f, 10.f };
+        grid.updateBodyCell(handles[2]);
+        bodies[0].position = { 5.f, 10.f };
+        grid.updateBodyCell(handles[0]);
+        tracker.update(grid, 3.f, on_begin, on_end);
+        expect(begin_count == 2_i); // (1, 2)
+        expect(end_count == 1_i); // (0, 1)
+
+        // Removing a body ends its contacts, even if its slot is reused by a body at the same position.
+        grid.removeBody(handles[2]);
+        Body body { { 14.f, 10.f } };
+        const auto handle = grid.addBody(&body);
+        expect(handle.index == handles[2].index);
+        std::vector<Grid::BodyHandle> ended;
+        tracker.update(grid, 3.f, on_begin, [&](Grid::BodyHandle handle1, Grid::BodyHandle handle2){
+            ended.push_back(handle1);
+            ended.push_back(handle2);
+        });
+        expect(begin_count == 3_i);
+        expect(std::ranges::find(ended, handles[2]) != ended.end());
+        expect(!grid.contains(handles[2]));
+    };
+
+    "events"_test = []{
+        Grid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution dis { 0.f, 100.f };
+        std::uniform_real_distribution step_dis { -0.5f, 0.5f };
+        std::vector<Body> bodies;
+        for (int i = 0; i < 500; ++i) {
+            bodies.push_back(Body { { dis(gen), dis(gen) } });
+        }
+        std::vector<Grid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+
+        // Applying events to the previous brute force set gives the next one.
+        using pair_t = std::pair<std::uint32_t, std::uint32_t>;
+        const auto make_pair = [](Grid::BodyHandle handle1, Grid::BodyHandle handle2){
+            return pair_t { std::min(handle1.index, handle2.index), std::max(handle1.index, handle2.index) };
+        };
+
+        ContactTracker tracker;
+        std::set<pair_t> tracked;
+        for (int step = 0; step < 10; ++step) {
+            for (std::size_t i = 0; i < bodies.size(); ++i) {
+                auto &position = bodies[i].position;
+                position[0] = std::clamp(position[0] + step_dis(gen), 0.f, 99.9f);
+                position[1] = std::clamp(position[1] + step_dis(gen), 0.f, 99.9f);
+                grid.updateBodyCell(handles[i]);
+            }
+
+            tracker.update(grid, 4.f, [&](Grid::BodyHandle handle1, Grid::BodyHandle handle2){
+                expect(tracked.insert(make_pair(handle1, handle2)).second);
+            }, [&](Grid::BodyHandle handle1, Grid::BodyHandle handle2){
+                expect(tracked.erase(make_pair(handle1, handle2)) == 1_i);
+            });
+
+            std::set<pair_t> expected;
+            for (std::uint32_t i = 0; i < bodies.size(); ++i) {
+                for (std::uint32_t j = i + 1; j < bodies.size(); ++j) {
+                    if (BodyPositionGetter()(bodies[i]).distance2(BodyPositionGetter()(bodies[j])) <= 16.f) {
+                        expected.emplace(i, j);
+                    }
+                }
+            }
+            expect(tracked == expected);
+            expect(tracker.getContacts().size() == expected.size());
+
+            // Contacts are in ascending order of body indices without a comparison sort.
+            std::vector<pair_t> contacts;
+            for (const auto &contact : tracker.getContacts()) {
+                contacts.emplace_back(contact.first.index, contact.second.index);
+            }
+            expect(std::ranges::equal(contacts, expected));
+        }
+    };
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <spatial/utils/distance_filter.hpp>
+#include <boost/ut.hpp>
+
+/**
+ * @brief Indices of points within distance, by plain scalar loop.
+ */
+template <typename T>
+std::vector<std::uint32_t> scalarWithinDistance(const std::vector<T> &xs, const std::vector<T> &ys, T center_x, T center_y, T distance_square){
+    std::vector<std::uint32_t> result;
+    for (std::size_t i = 0; i < xs.size(); ++i){
+        const auto dx = xs[i] - center_x;
+        const auto dy = ys[i] - center_y;
+        if (dx * dx + dy * dy <= distance_square){
+            result.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    return result;
+}
+
+template <typename T>
+void testFilterWithinDistance(){
+    using namespace boost::ut;
+
+    // Points at exactly distance 5 from center (1, 2), which are exact in both float and double, mixed with random
+    // points inside and outside.
+    const std::array<std::array<T, 2>, 4> boundary_offsets { { { 3, 4 }, { -4, 3 }, { 5, 0 }, { 0, -5 } } };
+    const T center_x = 1, center_y = 2, distance_square = 25;
+
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<T> dis { -8, 8 };
+    for (std::size_t count = 0; count <= 17; ++count){
+        std::vector<T> xs, ys;
+        for (std::size_t i = 0; i < count; ++i){
+            if (i % 3 == 0){
+                const auto &offset = boundary_offsets[(i / 3) % boundary_offsets.size()];
+                xs.push_back(center_x + offset[0]);
+                ys.push_back(center_y + offset[1]);
+            }
+            else{
+                xs.push_back(center_x + dis(gen));
+                ys.push_back(center_y + dis(gen));
+            }
+        }
+        const auto expected = scalarWithinDistance(xs, ys, center_x, center_y, distance_square);
+
+        std::vector<std::uint32_t> out(count);
+        const auto hit_count = spatial::utils::filterWithinDistance(xs.data(), ys.data(), count, center_x, center_y, distance_square, out.data());
+        out.resize(hit_count);
+        expect(out == expected);
+
+        std::vector<std::uint32_t> visited;
+        spatial::utils::forEachWithinDistance<T>(xs, ys, center_x, center_y, distance_square, [&](std::size_t i){
+            visited.push_back(static_cast<std::uint32_t>(i));
+        });
+        expect(visited == expected);
+    }
+}
+
+int main(){
+    using namespace boost::ut;
+
+    "filterWithinDistance (float)"_test = []{
+        testFilterWithinDistance<float>();
+    };
+
+    "filterWithinDistance (double)"_test = []{
+        testFilterWithinDistance<double>();
+    };
+
+    "forEachWithinDistance (multiple chunks)"_test = []{
+        // More points than the chunk of 256 hits, all within distance.
+        const std::vector<float> xs(600, 1.f), ys(600, 0.f);
+        std::vector<std::size_t> visited;
+        spatial::utils::forEachWithinDistance<float>(xs, ys, 0.f, 0.f, 1.f, [&](std::size_t i){
+            visited.push_back(i);
+        });
+        expect(visited.size() == 600_i);
+        expect(std::ranges::is_sorted(visited));
+        expect(visited.back() == 599_i);
+    };
+}
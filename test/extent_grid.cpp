@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <random>
+
+#include <spatial/extent_grid.hpp>
+#include <boost/ut.hpp>
+
+#include "bounds_body.hpp"
+
+using ExtentGrid = spatial::ExtentGrid<float, Body, BodyBoundsGetter, spatial::PointerBodyStorage<Body>>;
+
+int main(){
+    using namespace boost::ut;
+
+    "ExtentGrid::ExtentGrid"_test = []{
+        const ExtentGrid grid(spatial::FloatRect(0, 0, 100, 100), 20, 10);
+        expect(grid.getRowCount() == 20_i);
+        expect(grid.getColumnCount() == 10_i);
+
+#ifndef NDEBUG
+        expect(throws<std::invalid_argument>([](){
+            ExtentGrid(spatial::FloatRect(0, 0, 100, 100), 1, 0);
+        }));
+#endif
+    };
+
+    "addBody"_test = []{
+        ExtentGrid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        Body small { { 15.f, 15.f }, 1.f }; // (1, 1)
+        Body large { { 50.f, 50.f }, 25.f }; // (2, 2) ... (7, 7)
+        Body outside { { -20.f, 50.f }, 5.f }; // Clamped to (4, 0) ... (5, 0)
+
+        const auto small_handle = grid.addBody(&small);
+        const auto large_handle = grid.addBody(&large);
+        const auto outside_handle = grid.addBody(&outside);
+        expect(grid.getBodyCount() == 3_i);
+        expect(grid.getCellCount(small_handle) == 1_i);
+        expect(grid.getCellCount(large_handle) == 36_i);
+        expect(grid.getCellCount(outside_handle) == 2_i);
+
+        expect(grid.removeBody(large_handle));
+        expect(!grid.removeBody(large_handle));
+        expect(!grid.contains(large_handle));
+        expect(grid.getBodyCount() == 2_i);
+
+        grid.clearAllBodies();
+        expect(grid.getBodyCount() == 0_i);
+        expect(!grid.contains(small_handle));
+    };
+
+    "queries"_test = []{
+        ExtentGrid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        // Sizes of bodies vary by 50x, so most of them are larger than a cell.
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> position_dis(0.f, 100.f);
+        std::uniform_real_distribution<float> size_dis(0.5f, 25.f);
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 300; ++i) {
+            bodies.push_back(Body { { position_dis(gen), position_dis(gen) }, size_dis(gen) });
+        }
+
+        std::vector<Body*> body_pointers;
+        std::vector<ExtentGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            body_pointers.push_back(&body);
+            handles.push_back(grid.addBody(&body));
+        }
+
+        const auto check = [&]{
+            expectQueriesMatchBruteForce(grid, body_pointers, handles,
+                                         { spatial::FloatRect(20, 30, 55, 47), spatial::FloatRect(-50, -50, 0, 10), spatial::FloatRect(-10, -10, 200, 200) });
+        };
+        check();
+
+        // Move and resize bodies.
+        std::uniform_real_distribution<float> move_dis(-15.f, 15.f);
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            bodies[i].position[0] += move_dis(gen);
+            bodies[i].position[1] += move_dis(gen);
+            if (i % 3 == 0) {
+                bodies[i].half_size = size_dis(gen);
+            }
+            grid.updateBodyCells(handles[i]);
+        }
+        check();
+    };
+}
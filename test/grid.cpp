@@ -2,10 +2,14 @@
 // Created by gomkyung2 on 2023/08/11.
 //
 
+#include <atomic>
+#include <ranges>
 #include <random>
 #include <numbers>
+#include <numeric>
 
 #include <spatial/grid.hpp>
+#include <spatial/utils/permutation.hpp>
 #include <boost/ut.hpp>
 
 struct Body{
@@ -68,16 +72,77 @@ int main(){
     "addBody"_test = []{
         spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 5);
 
-        const auto &cell1 = grid.addBody(std::make_shared<Body>(std::array { 3.f, 5.7f })); // (0, 0)
-        const auto &cell2 = grid.addBody(std::make_shared<Body>(std::array { 12.f, 8.3f })); // (0, 0)
-        expect(&cell1 == &cell2);
+        const auto handle1 = grid.addBody(std::make_shared<Body>(std::array { 3.f, 5.7f })); // (0, 0)
+        const auto handle2 = grid.addBody(std::make_shared<Body>(std::array { 12.f, 8.3f })); // (0, 0)
+        expect(handle1 != handle2);
+        expect(grid.getCellIndex(handle1) == grid.getCellIndex(handle2));
 
-        const auto &cell3 = grid.addBody(std::make_shared<Body>(std::array { 14.4f, 20.8f })); // (2, 0)
-        expect(&cell1 != &cell3);
+        const auto handle3 = grid.addBody(std::make_shared<Body>(std::array { 14.4f, 20.8f })); // (2, 0)
+        expect(grid.getCellIndex(handle3) == std::array<std::size_t, 2> { 2, 0 });
+        expect(grid.getBody(handle3).position == std::array { 14.4f, 20.8f });
+        expect(std::ranges::distance(grid.getCellBodies(0, 0)) == 2_i);
 
         expect(grid.getBodyCount() == 3_i);
     };
 
+    "assign"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 5);
+        grid.addBody(std::make_shared<Body>(std::array { 50.f, 50.f })); // Replaced by assign.
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution dis { 0.f, 100.f };
+
+        std::vector<std::shared_ptr<Body>> bodies;
+        for (int i = 0; i < 1000; ++i) {
+            bodies.push_back(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+        }
+
+        for (std::size_t num_threads : { 1, 4 }) {
+            grid.assign(bodies, num_threads);
+            expect(grid.getBodyCount() == 1000_i);
+
+            // Every body is in its own cell, and i-th body has slot i.
+            for (std::uint32_t i = 0; i < bodies.size(); ++i) {
+                const auto [row, col] = grid.getCellIndex(*bodies[i]);
+                expect(std::ranges::any_of(grid.getCellBodies(row, col), [&](const Body &body){ return &body == bodies[i].get(); }));
+                expect(&grid.getBody(grid.getBodyHandle(i)) == bodies[i].get());
+            }
+            expect(grid.queryDistancePair(5.f, 1).size() == grid.queryDistancePair(5.f).size());
+        }
+    };
+
+    "assign (index storage)"_test = []{
+        std::mt19937 gen(0);
+        std::uniform_real_distribution dis { 0.f, 100.f };
+
+        std::vector<Body> bodies;
+        for (int i = 0; i < 5000; ++i) {
+            bodies.push_back(Body { { dis(gen), dis(gen) } });
+        }
+
+        using IndexGrid = spatial::Grid<float, Body, BodyPositionGetter, spatial::IndexBodyStorage<Body>>;
+        IndexGrid serial(spatial::FloatRect(0, 0, 100, 100), 16, 16, spatial::IndexBodyStorage<Body> { bodies });
+        serial.assign(std::views::iota(0U, static_cast<unsigned>(bodies.size())));
+
+        // Cells, and so the order of pairs, do not depend on the number of threads.
+        IndexGrid parallel(spatial::FloatRect(0, 0, 100, 100), 16, 16, spatial::IndexBodyStorage<Body> { bodies });
+        for (std::size_t num_threads : { 2, 7, 64 }) {
+            parallel.assign(std::views::iota(0U, static_cast<unsigned>(bodies.size())), num_threads);
+            for (std::size_t row = 0; row < 16; ++row) {
+                for (std::size_t col = 0; col < 16; ++col) {
+                    expect(std::ranges::equal(serial.getCellBodies(row, col), parallel.getCellBodies(row, col), [](const Body &lhs, const Body &rhs){ return &lhs == &rhs; }));
+                }
+            }
+            expect(parallel.queryDistancePair(5.f) == serial.queryDistancePair(5.f));
+            expect(parallel.queryDistancePair(20.f, num_threads) == serial.queryDistancePair(20.f));
+        }
+
+        // Assigning fewer bodies replaces the whole contents.
+        parallel.assign(std::views::iota(1U, 2U));
+        expect(parallel.getBodyCount() == 1_i);
+        expect(&parallel.getBody(parallel.getBodyHandle(0)) == &bodies[1]);
+    };
+
     "removeBody"_test = []{
         // Add 100 bodies to grid and remove all.
         spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 5);
@@ -86,24 +151,25 @@ int main(){
         std::mt19937 gen(rd());
         std::uniform_real_distribution dis { 0.f, 100.f };
 
-        std::vector<std::shared_ptr<Body>> bodies;
+        std::vector<decltype(grid)::BodyHandle> handles;
         for (int i = 0; i < 100; ++i) {
-            auto body = std::make_shared<Body>(std::array { dis(gen), dis(gen) });
-            grid.addBody(body);
-
-            bodies.emplace_back(std::move(body));
+            handles.push_back(grid.addBody(std::make_shared<Body>(std::array { dis(gen), dis(gen) })));
         }
 
-        std::vector<std::size_t> removed_counts;
-        removed_counts.reserve(100);
-        for (const auto &body : bodies){
-            auto &cell = grid.getBodyCell(*body);
-            auto removed_count = grid.removeBody(*body, cell);
-
-            removed_counts.push_back(removed_count);
+        std::vector<bool> removed;
+        removed.reserve(100);
+        for (auto handle : handles){
+            removed.push_back(grid.removeBody(handle));
         }
 
-        expect(std::all_of(removed_counts.cbegin(), removed_counts.cend(), [](auto count){ return count == 1; }));
+        expect(std::all_of(removed.cbegin(), removed.cend(), [](bool value){ return value; }));
+        expect(grid.getBodyCount() == 0_i);
+
+        // Removed handles are invalidated, even if their slot is reused.
+        expect(!grid.removeBody(handles.front()));
+        const auto new_handle = grid.addBody(std::make_shared<Body>(std::array { 50.f, 50.f }));
+        expect(std::ranges::none_of(handles, [&](auto handle){ return grid.contains(handle); }));
+        expect(grid.contains(new_handle));
     };
 
     "clearAllBodies"_test = []{
@@ -127,35 +193,198 @@ int main(){
         spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 5);
 
         auto body = std::make_shared<Body>(std::array { 3.f, 5.7f });
-        auto &previous_cell = grid.addBody(body); // (0, 0)
+        const auto handle = grid.addBody(body); // (0, 0)
 
-        body->position = { 14.4f, 20.8f }; // (2, 0)
-        auto &current_cell = grid.updateBodyCell(*body, previous_cell);
+        // Bodies that share the cell with body. Moving body out swaps the last one into its place.
+        std::vector<decltype(grid)::BodyHandle> others;
+        for (int i = 0; i < 3; ++i) {
+            others.push_back(grid.addBody(std::make_shared<Body>(std::array { 5.f + static_cast<float>(i), 5.f }))); // (0, 0)
+        }
 
-        expect(std::distance(&previous_cell, &current_cell) == 10_i); // Grid is 10x5 -> 5 cells per row. 5 * 2 = 10.
+        body->position = { 14.4f, 20.8f }; // (2, 0)
+        expect(grid.updateBodyCell(handle) == std::array<std::size_t, 2> { 2, 0 });
+        expect(grid.getCellIndex(handle) == std::array<std::size_t, 2> { 2, 0 });
+        expect(std::ranges::distance(grid.getCellBodies(0, 0)) == 3_i);
+
+        // Remaining bodies are still reachable by their handles.
+        grid.getBody(others.back()).position = { 16.f, 25.f }; // (2, 0)
+        expect(grid.updateBodyCell(others.back()) == std::array<std::size_t, 2> { 2, 0 });
+        expect(grid.removeBody(others.front()));
+        expect(std::ranges::distance(grid.getCellBodies(0, 0)) == 1_i);
+        expect(std::ranges::distance(grid.getCellBodies(2, 0)) == 2_i);
+
+        // Moving within the same cell must refresh the cached position.
+        auto other = std::make_shared<Body>(std::array { 15.f, 28.f }); // (2, 0)
+        const auto other_handle = grid.addBody(other);
+        expect(grid.queryDistance(handle, 5.f).size() == 1_i); // (16, 25)
+
+        other->position = { 15.f, 21.f }; // (2, 0)
+        grid.updateBodyCell(other_handle);
+        expect(grid.queryDistance(handle, 5.f).size() == 2_i);
+        expect(grid.queryDistance(*body, 5.f).size() == 2_i);
     };
 
     "queryDistance"_test = []{
         spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 2, 2), 2, 2);
 
         auto body1 = std::make_shared<Body>(std::array { 0.9f, 0.9f });
-        auto cell_index1 = grid.getCellIndex(*body1);
         grid.addBody(body1);
 
-        expect(grid.queryDistance(*body1, cell_index1, 0.5f).empty()); // self should not be included.
-#ifndef NDEBUG
-        expect(throws<std::invalid_argument>([&]{
-            grid.queryDistance(*body1, cell_index1, 1.2f); // distance exceeds cell size.
-        }));
-#endif
+        expect(grid.queryDistance(*body1, 0.5f).empty()); // self should not be included.
 
         grid.addBody(std::make_shared<Body>(std::array { 1.1f, 0.9f })); // 2
         grid.addBody(std::make_shared<Body>(std::array { 0.9f, 1.1f })); // 3
         grid.addBody(std::make_shared<Body>(std::array { 1.1f, 1.1f })); // 4
 
-        expect(grid.queryDistance(*body1, cell_index1, 0.1f).size() == 0_i); // nothing in distance 0.1f
-        expect(grid.queryDistance(*body1, cell_index1, 0.2001f).size() == 2_i); // 2, 3 in distance 0.2001f (marginal 0.001f for floating point error)
-        expect(grid.queryDistance(*body1, cell_index1, 0.3f).size() == 3_i); // 2, 3, 4 in distance 0.3f
+        expect(grid.queryDistance(*body1, 0.1f).size() == 0_i); // nothing in distance 0.1f
+        expect(grid.queryDistance(*body1, 0.2001f).size() == 2_i); // 2, 3 in distance 0.2001f (marginal 0.001f for floating point error)
+        expect(grid.queryDistance(*body1, 0.3f).size() == 3_i); // 2, 3, 4 in distance 0.3f
+        expect(grid.queryDistance(*body1, 5.f).size() == 3_i); // distance greater than cell size
+
+        // Visitor overload visits the same bodies.
+        std::vector<const Body*> visited;
+        grid.queryDistance(*body1, 0.2001f, [&](Body &other){ visited.push_back(&other); });
+        expect(visited.size() == 2_i);
+        expect(std::ranges::find(visited, body1.get()) == visited.end());
+    };
+
+    "queryRect"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis(0.f, 100.f);
+        std::vector<std::shared_ptr<Body>> bodies;
+        for (auto i = 0; i < 1000; ++i) {
+            bodies.push_back(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+            grid.addBody(bodies.back());
+        }
+        auto corner = std::make_shared<Body>(std::array { 20.f, 30.f }); // On the boundary of rect below.
+        bodies.push_back(corner);
+        grid.addBody(corner);
+
+        for (const auto &rect : { spatial::FloatRect(20, 30, 55, 47), spatial::FloatRect(21, 31, 29, 39), spatial::FloatRect(-10, -10, 200, 200),
+                                  spatial::FloatRect(-50, 40, 15, 60), spatial::FloatRect(150, 150, 200, 200) }) {
+            const auto expected = std::ranges::count_if(bodies, [&](const auto &body){
+                return rect.contains(BodyPositionGetter()(*body));
+            });
+            expect(grid.queryRect(rect).size() == static_cast<std::size_t>(expected));
+
+            std::size_t visited = 0;
+            grid.queryRect(rect, [&](Body &body){
+                expect(rect.contains(BodyPositionGetter()(body)));
+                ++visited;
+            });
+            expect(visited == static_cast<std::size_t>(expected));
+        }
+
+        const auto result = grid.queryRect(spatial::FloatRect(20, 30, 55, 47));
+        expect(std::ranges::find(result, corner) != result.end());
+    };
+
+    "raycast"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+        expect(!grid.raycast({ 0.f, 0.f }, { 1.f, 1.f }, 200.f, 1.f).has_value());
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis(0.f, 100.f);
+        std::vector<std::shared_ptr<Body>> bodies;
+        for (auto i = 0; i < 300; ++i) {
+            bodies.push_back(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+            grid.addBody(bodies.back());
+        }
+
+        // Distances where ray hits each body by brute force.
+        const auto brute_force = [&](const spatial::Vector2f &origin, const spatial::Vector2f &direction, float max_distance, float radius){
+            const auto unit_direction = direction * (1.f / std::hypot(direction.x, direction.y));
+            std::vector<float> distances;
+            for (const auto &body : bodies) {
+                const auto to_body = BodyPositionGetter()(*body) - origin;
+                const auto projection = to_body.dot(unit_direction);
+                const auto perpendicular_square = to_body.dot(to_body) - projection * projection;
+                if (perpendicular_square > radius * radius) {
+                    continue;
+                }
+                auto t = projection - std::sqrt(radius * radius - perpendicular_square);
+                if (t < 0 && to_body.dot(to_body) > radius * radius) {
+                    continue;
+                }
+                if (std::max(t, 0.f) <= max_distance) {
+                    distances.push_back(std::max(t, 0.f));
+                }
+            }
+            std::ranges::sort(distances);
+            return distances;
+        };
+
+        std::uniform_real_distribution<float> origin_dis(-20.f, 120.f);
+        std::uniform_real_distribution<float> direction_dis(-1.f, 1.f);
+        for (auto i = 0; i < 200; ++i) {
+            const spatial::Vector2f origin { origin_dis(gen), origin_dis(gen) };
+            spatial::Vector2f direction { direction_dis(gen), direction_dis(gen) };
+            if (i % 10 == 0) {
+                direction = { i % 20 == 0 ? 1.f : 0.f, i % 20 == 0 ? 0.f : -1.f }; // Axis-aligned ray.
+            }
+            const auto max_distance = i % 3 == 0 ? 40.f : 300.f;
+            const auto radius = i % 4 == 0 ? 0.5f : 13.f;
+
+            const auto expected = brute_force(origin, direction, max_distance, radius);
+            const auto hits = grid.raycastAll(origin, direction, max_distance, radius);
+            expect(hits.size() == expected.size());
+
+            const auto hit = grid.raycast(origin, direction, max_distance, radius);
+            expect(hit.has_value() == !expected.empty());
+            if (hit && !expected.empty()) {
+                expect(std::abs(hit->distance - expected.front()) < 1e-3f);
+            }
+        }
+    };
+
+    "queryNearest"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+        expect(grid.queryNearest(spatial::Vector2f { 50.f, 50.f }, 3).empty());
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis(0.f, 100.f);
+        std::vector<std::shared_ptr<Body>> bodies;
+        std::vector<decltype(grid)::BodyHandle> handles;
+        for (auto i = 0; i < 500; ++i) {
+            bodies.push_back(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+            handles.push_back(grid.addBody(bodies.back()));
+        }
+
+        // Distances of the k nearest bodies by brute force.
+        const auto brute_force = [&](const spatial::Vector2f &position, std::size_t k, const Body *excluded){
+            std::vector<float> distances;
+            for (const auto &body : bodies) {
+                if (body.get() != excluded) {
+                    distances.push_back(position.distance2(BodyPositionGetter()(*body)));
+                }
+            }
+            std::ranges::sort(distances);
+            distances.resize(std::min(k, distances.size()));
+            return distances;
+        };
+        const auto distances_of = [](const spatial::Vector2f &position, const std::vector<std::shared_ptr<Body>> &result){
+            std::vector<float> distances;
+            for (const auto &body : result) {
+                distances.push_back(position.distance2(BodyPositionGetter()(*body)));
+            }
+            return distances;
+        };
+
+        for (spatial::Vector2f position : { spatial::Vector2f { 50.f, 50.f }, spatial::Vector2f { 0.5f, 99.f }, spatial::Vector2f { -30.f, 140.f } }) {
+            for (std::size_t k : { 1, 7, 60, 1000 }) {
+                expect(distances_of(position, grid.queryNearest(position, k)) == brute_force(position, k, nullptr));
+            }
+        }
+
+        // Body itself is excluded when querying by handle.
+        for (std::size_t i = 0; i < bodies.size(); i += 50) {
+            const auto position = BodyPositionGetter()(*bodies[i]);
+            const auto nearest = grid.queryNearest(handles[i], 5);
+            expect(std::ranges::find(nearest, bodies[i]) == nearest.end());
+            expect(distances_of(position, nearest) == brute_force(position, 5, bodies[i].get()));
+        }
     };
 
     "queryDistancePair"_test = []{
@@ -209,5 +438,392 @@ int main(){
             expect(grid.queryDistancePair(0.26f).size() == 100_i);
             expect(grid.queryDistancePair(8.001f).size() == 4950_i); // C(100, 2) = 4950
         }
+
+        {
+            // Pairs across anti-diagonal cells, like (0, 1) and (1, 0), must be found too, as well as pairs farther than
+            // adjacent cells when distance is greater than cell size.
+            spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+            std::mt19937 gen(0);
+            std::uniform_real_distribution dis { 0.f, 100.f };
+
+            std::vector<std::shared_ptr<Body>> bodies;
+            for (int i = 0; i < 1000; ++i) {
+                bodies.push_back(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+                grid.addBody(bodies.back());
+            }
+
+            for (float distance : { 1.f, 5.f, 10.f, 17.f, 35.f, 200.f }) {
+                std::size_t expected = 0;
+                for (std::size_t i = 0; i < bodies.size(); ++i) {
+                    for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                        if (BodyPositionGetter()(*bodies[i]).distance2(BodyPositionGetter()(*bodies[j])) <= distance * distance) {
+                            ++expected;
+                        }
+                    }
+                }
+
+                std::size_t visited = 0;
+                grid.queryDistancePair(distance, [&](Body&, Body&){ ++visited; });
+                expect(visited == expected);
+
+                auto pairs = grid.queryDistancePair(distance);
+                for (auto &pair : pairs) {
+                    std::ranges::sort(pair);
+                }
+                std::ranges::sort(pairs);
+                expect(pairs.size() == expected);
+                expect(std::ranges::adjacent_find(pairs) == pairs.end()); // Each pair appears once.
+
+                for (std::size_t i = 0; i < bodies.size(); i += 97) {
+                    const auto count = std::ranges::count_if(bodies, [&](const auto &other){
+                        return other != bodies[i] && BodyPositionGetter()(*bodies[i]).distance2(BodyPositionGetter()(*other)) <= distance * distance;
+                    });
+                    expect(grid.queryDistance(*bodies[i], distance).size() == static_cast<std::size_t>(count));
+                }
+            }
+        }
+    };
+
+    "queryDistancePair (parallel)"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution dis { 0.f, 100.f };
+        for (int i = 0; i < 1000; ++i) {
+            grid.addBody(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+        }
+
+        // Merged result is same as single threaded one, including order.
+        const auto expected = grid.queryDistancePair(5.f);
+        for (std::size_t num_threads : { 1, 3, 4, 32 }) {
+            expect(grid.queryDistancePair(5.f, num_threads) == expected);
+        }
+
+        std::atomic<std::size_t> visited = 0;
+        grid.queryDistancePair(5.f, 4, [&](Body&, Body&, std::size_t){
+            ++visited;
+        });
+        expect(visited == expected.size());
+    };
+
+    "periodic boundary"_test = []{
+        using PeriodicGrid = spatial::Grid<float, Body, BodyPositionGetter>;
+
+        {
+            PeriodicGrid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10, spatial::GridBoundary::Periodic);
+            expect(grid.getCellIndex(spatial::Vector2f { 105.f, -5.f }) == std::array<std::size_t, 2> { 9, 0 });
+            expect(grid.getCellIndex(spatial::Vector2f { -1e-9f, 250.f }) == std::array<std::size_t, 2> { 5, 0 });
+
+            // Bodies across the edges are neighbors.
+            auto body1 = std::make_shared<Body>(std::array { 1.f, 50.f });
+            auto body2 = std::make_shared<Body>(std::array { 99.f, 50.f });
+            auto body3 = std::make_shared<Body>(std::array { 101.f, -49.f }); // (1, 51) after wrapped.
+            grid.addBody(body1);
+            grid.addBody(body2);
+            grid.addBody(body3);
+            expect(grid.queryDistance(*body1, 2.5f).size() == 2_i);
+            expect(grid.queryDistancePair(2.5f).size() == 3_i);
+            expect(grid.queryDistancePair(1.5f).size() == 1_i);
+
+#ifndef NDEBUG
+            expect(throws<std::invalid_argument>([&](){
+                grid.queryDistancePair(50.f);
+            }));
+#endif
+        }
+
+        // Compare with brute force using the minimum image convention, including grids narrower than the stencil.
+        for (const auto &[rows, columns] : { std::pair<std::size_t, std::size_t> { 10, 10 }, { 3, 1 }, { 7, 2 } }) {
+            PeriodicGrid grid(spatial::FloatRect(-50, 0, 50, 80), rows, columns, spatial::GridBoundary::Periodic);
+
+            std::mt19937 gen(0);
+            std::uniform_real_distribution dis { -150.f, 150.f }; // Out of bound positions are wrapped.
+            std::vector<std::shared_ptr<Body>> bodies;
+            for (int i = 0; i < 500; ++i) {
+                bodies.push_back(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+                grid.addBody(bodies.back());
+            }
+
+            const auto image_distance2 = [](const Body &body1, const Body &body2){
+                auto dx = std::abs(body1.position[0] - body2.position[0]);
+                auto dy = std::abs(body1.position[1] - body2.position[1]);
+                dx = std::fmod(dx, 100.f);
+                dy = std::fmod(dy, 80.f);
+                dx = std::min(dx, 100.f - dx);
+                dy = std::min(dy, 80.f - dy);
+                return dx * dx + dy * dy;
+            };
+
+            for (float distance : { 3.f, 11.f, 25.f, 39.f }) {
+                std::size_t expected = 0;
+                for (std::size_t i = 0; i < bodies.size(); ++i) {
+                    for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                        expected += image_distance2(*bodies[i], *bodies[j]) <= distance * distance;
+                    }
+                }
+
+                auto pairs = grid.queryDistancePair(distance);
+                for (auto &pair : pairs) {
+                    std::ranges::sort(pair);
+                }
+                std::ranges::sort(pairs);
+                expect(pairs.size() == expected);
+                expect(std::ranges::adjacent_find(pairs) == pairs.end()); // Each pair appears once.
+                expect(grid.queryDistancePair(distance, 3).size() == expected);
+
+                for (std::size_t i = 0; i < bodies.size(); i += 37) {
+                    const auto count = std::ranges::count_if(bodies, [&](const auto &other){
+                        return other != bodies[i] && image_distance2(*bodies[i], *other) <= distance * distance;
+                    });
+                    expect(grid.queryDistance(*bodies[i], distance).size() == static_cast<std::size_t>(count));
+                }
+            }
+        }
+    };
+
+    "resize"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 2, 2);
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis { 0.f, 99.9f };
+        std::vector<spatial::Grid<float, Body, BodyPositionGetter>::BodyHandle> handles;
+        for (int i = 0; i < 200; ++i) {
+            handles.push_back(grid.addBody(std::make_shared<Body>(std::array { dis(gen), dis(gen) })));
+        }
+        grid.removeBody(handles[7]);
+
+        const auto expected = grid.queryDistance(handles[0], 15.f);
+        grid.resize(20, 10);
+        expect(grid.getRowCount() == 20_i);
+        expect(grid.getColumnCount() == 10_i);
+        expect(grid.cellSize() == spatial::Vector2f { 10, 5 });
+        expect(grid.getBodyCount() == 199_i);
+        expect(!grid.contains(handles[7]));
+
+        // Handles stay valid, and bodies are in the cells of their positions.
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            if (i != 7) {
+                expect(grid.getCellIndex(handles[i]) == grid.getCellIndex(grid.getBody(handles[i])));
+            }
+        }
+        auto actual = grid.queryDistance(handles[0], 15.f);
+        expect(std::ranges::is_permutation(actual, expected));
+
+        // Grid is usable after resize.
+        auto &body = grid.getBody(handles[1]);
+        body.position = { 0.5f, 0.5f };
+        grid.updateBodyCell(handles[1]);
+        expect(grid.getCellIndex(handles[1]) == std::array<std::size_t, 2> { 0, 0 });
+
+#ifndef NDEBUG
+        expect(throws<std::invalid_argument>([&grid](){
+            grid.resize(0, 1);
+        }));
+#endif
+    };
+
+    "retune"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 1, 1);
+        expect(grid.retune(2.f) == std::array<std::size_t, 2> { 1, 1 }); // Nothing to tune for empty grid.
+
+        // Sparse bodies get cells of about one body each.
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis { 0.f, 99.9f };
+        for (int i = 0; i < 25; ++i) {
+            grid.addBody(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+        }
+        expect(grid.retune(2.f) == std::array<std::size_t, 2> { 5, 5 });
+
+        // Dense bodies are limited by query radius.
+        for (int i = 0; i < 10000; ++i) {
+            grid.addBody(std::make_shared<Body>(std::array { dis(gen), dis(gen) }));
+        }
+        expect(grid.retune(4.f) == std::array<std::size_t, 2> { 25, 25 });
+
+        // Small change of resolution is ignored.
+        expect(grid.retune(4.5f) == std::array<std::size_t, 2> { 25, 25 });
+        expect(grid.retune(4.5f, 0.f) == std::array<std::size_t, 2> { 22, 22 });
+
+        // Queries give the same result as brute force.
+        const auto handle = grid.getBodyHandle(0);
+        const auto &body = grid.getBody(handle);
+        std::size_t expected = 0;
+        for (std::size_t slot_index = 1; slot_index < grid.getSlotCount(); ++slot_index) {
+            const auto &other = grid.getBody(grid.getBodyHandle(slot_index));
+            const auto dx = other.position[0] - body.position[0], dy = other.position[1] - body.position[1];
+            expected += dx * dx + dy * dy <= 16.f;
+        }
+        expect(grid.queryDistance(handle, 4.f).size() == expected);
+    };
+
+    "retune (clustered)"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 20, 20);
+
+        // Bodies packed in one cell would ask for tiny cells, but at most 4 cells per body are made.
+        for (int i = 0; i < 25; ++i) {
+            grid.addBody(std::make_shared<Body>(std::array { 1.f + 0.1f * static_cast<float>(i), 1.f }));
+        }
+        expect(grid.retune(0.5f) == std::array<std::size_t, 2> { 10, 10 });
+        expect(grid.queryDistance(grid.getBodyHandle(0), 1.05f).size() == 10_i);
+    };
+
+    "cell layout"_test = []{
+        // Every layout maps each 2D index to a distinct offset in its storage.
+        const auto is_bijective = []<typename Layout>(Layout layout, std::size_t rows, std::size_t columns){
+            std::vector<bool> used(layout.size());
+            for (std::size_t row = 0; row < rows; ++row){
+                for (std::size_t col = 0; col < columns; ++col){
+                    const auto offset = layout(row, col);
+                    if (offset >= used.size() || used[offset]){
+                        return false;
+                    }
+                    used[offset] = true;
+                }
+            }
+            return true;
+        };
+        for (const auto &[rows, columns] : { std::array<std::size_t, 2> { 1, 1 }, { 7, 13 }, { 16, 16 }, { 3, 40 }, { 33, 5 } }){
+            expect(is_bijective(spatial::utils::RowMajorLayout(rows, columns), rows, columns));
+            expect(is_bijective(spatial::utils::TiledLayout<4>(rows, columns), rows, columns));
+            expect(is_bijective(spatial::utils::MortonLayout(rows, columns), rows, columns));
+        }
+
+        const spatial::utils::MortonLayout morton(4, 8);
+        expect(morton.size() == 32_i);
+        expect(morton(0, 1) == 1_i);
+        expect(morton(1, 0) == 2_i);
+        expect(morton(1, 1) == 3_i);
+        expect(morton(2, 2) == 12_i);
+        expect(morton(0, 4) == 16_i); // Second 4x4 square.
+
+        // Grids of different layouts give the same results.
+        spatial::Grid<float, Body, BodyPositionGetter> row_major_grid(spatial::FloatRect(0, 0, 100, 100), 23, 17);
+        spatial::Grid<float, Body, BodyPositionGetter, spatial::SharedBodyStorage<Body>, spatial::utils::MortonLayout> morton_grid(
+            spatial::FloatRect(0, 0, 100, 100), 23, 17);
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis { 0.f, 99.9f };
+        for (int i = 0; i < 500; ++i) {
+            const auto body = std::make_shared<Body>(std::array { dis(gen), dis(gen) });
+            row_major_grid.addBody(body);
+            morton_grid.addBody(body);
+        }
+        for (std::size_t slot_index = 0; slot_index < 500; ++slot_index){
+            auto actual = morton_grid.queryDistance(morton_grid.getBodyHandle(slot_index), 8.f);
+            expect(std::ranges::is_permutation(actual, row_major_grid.queryDistance(row_major_grid.getBodyHandle(slot_index), 8.f)));
+        }
+        expect(morton_grid.queryDistancePair(8.f).size() == row_major_grid.queryDistancePair(8.f).size());
+        expect(morton_grid.getOccupancyHistogram() == row_major_grid.getOccupancyHistogram());
+    };
+
+    "getSpatialOrder"_test = []{
+        // One body per cell of 4x4 grid, added in reverse row major order.
+        std::vector<Body> bodies;
+        for (int i = 16; i-- > 0;) {
+            bodies.push_back(Body { { 2.5f + 5.f * static_cast<float>(i % 4), 2.5f + 5.f * static_cast<float>(i / 4) } });
+        }
+        spatial::Grid<float, Body, BodyPositionGetter, spatial::IndexBodyStorage<Body>> grid(
+            spatial::FloatRect(0, 0, 20, 20), 4, 4, spatial::IndexBodyStorage<Body> { bodies });
+        grid.assign(std::views::iota(0U, 16U));
+
+        const auto cell_of = [&](unsigned index){
+            return grid.getCellIndex(bodies[index]);
+        };
+
+        // Morton order visits 2x2 blocks in Z shape.
+        const auto morton = grid.getSpatialOrder(spatial::SpatialOrder::Morton);
+        expect(morton.size() == 16_i);
+        expect(cell_of(morton[0]) == std::array<std::size_t, 2> { 0, 0 });
+        expect(cell_of(morton[1]) == std::array<std::size_t, 2> { 0, 1 });
+        expect(cell_of(morton[2]) == std::array<std::size_t, 2> { 1, 0 });
+        expect(cell_of(morton[3]) == std::array<std::size_t, 2> { 1, 1 });
+        expect(cell_of(morton[4]) == std::array<std::size_t, 2> { 0, 2 });
+
+        // Consecutive cells in Hilbert order are adjacent.
+        const auto hilbert = grid.getSpatialOrder();
+        expect(std::ranges::is_permutation(hilbert, std::views::iota(0U, 16U)));
+        expect(cell_of(hilbert[0]) == std::array<std::size_t, 2> { 0, 0 });
+        for (std::size_t i = 1; i < hilbert.size(); ++i) {
+            const auto [row1, col1] = cell_of(hilbert[i - 1]);
+            const auto [row2, col2] = cell_of(hilbert[i]);
+            expect((row1 > row2 ? row1 - row2 : row2 - row1) + (col1 > col2 ? col1 - col2 : col2 - col1) == 1);
+        }
+
+        // Reorder user array, with another array of the same bodies, then rebuild grid from it.
+        std::vector<int> ids(16);
+        std::iota(ids.begin(), ids.end(), 0);
+        const auto old_bodies = bodies;
+        spatial::utils::applyPermutation(hilbert, bodies, ids);
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            expect(bodies[i].position == old_bodies[hilbert[i]].position);
+            expect(ids[i] == static_cast<int>(hilbert[i]));
+        }
+        grid.assign(std::views::iota(0U, 16U));
+        expect(std::ranges::equal(grid.getSpatialOrder(), std::views::iota(0U, 16U)));
+
+#ifndef NDEBUG
+        expect(throws<std::invalid_argument>([&](){
+            spatial::utils::applyPermutation(hilbert, ids, std::vector<int>(3));
+        }));
+#endif
+    };
+
+    "getOccupancyStats"_test = []{
+        spatial::Grid<float, Body, BodyPositionGetter> grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        // 90 cells hold nothing, 9 cells hold 1 body and 1 cell holds 11 bodies.
+        for (int i = 0; i < 9; ++i) {
+            grid.addBody(std::make_shared<Body>(std::array { 5.f + 10.f * static_cast<float>(i), 5.f }));
+        }
+        for (int i = 0; i < 11; ++i) {
+            grid.addBody(std::make_shared<Body>(std::array { 95.f, 95.f }));
+        }
+
+        const auto histogram = grid.getOccupancyHistogram();
+        expect(histogram.size() == 12_i);
+        expect(histogram[0] == 90_i);
+        expect(histogram[1] == 9_i);
+        expect(histogram[11] == 1_i);
+
+        const auto stats = grid.getOccupancyStats();
+        expect(stats.max == 11_i);
+        expect(stats.empty_cells == 90_i);
+        expect(stats.mean == 0.2);
+        expect(stats.mean_occupied == 2.0);
+        expect(stats.p50 == 0_i);
+        expect(stats.p90 == 0_i);
+        expect(stats.p99 == 1_i);
+    };
+
+    "body storage"_test = []{
+        std::vector<Body> bodies {
+            Body { { 5.f, 5.f } },
+            Body { { 7.f, 5.f } },
+            Body { { 15.f, 5.f } },
+            Body { { 50.f, 50.f } },
+        };
+
+        // Bodies are referred by their indices in user array.
+        spatial::Grid<float, Body, BodyPositionGetter, spatial::IndexBodyStorage<Body>> index_grid(
+            spatial::FloatRect(0, 0, 100, 100), 10, 10, spatial::IndexBodyStorage<Body> { bodies });
+        index_grid.assign(std::views::iota(0U, static_cast<unsigned>(bodies.size())));
+        expect(index_grid.getBodyCount() == 4_i);
+        expect(&index_grid.getBody(index_grid.getBodyHandle(2)) == &bodies[2]);
+        expect(index_grid.queryDistance(index_grid.getBodyHandle(0), 3.f) == std::vector { 1U });
+        expect(index_grid.queryDistancePair(10.f).size() == 3_i);
+
+        bodies[1].position = { 55.f, 50.f };
+        index_grid.updateBodyCell(index_grid.getBodyHandle(1));
+        expect(index_grid.queryDistance(index_grid.getBodyHandle(3), 10.f) == std::vector { 1U });
+
+        // Bodies are referred by raw pointers.
+        spatial::Grid<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>> pointer_grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+        const auto handle = pointer_grid.addBody(&bodies[0]);
+        pointer_grid.addBody(&bodies[2]);
+        expect(&pointer_grid.getBody(handle) == &bodies[0]);
+        expect(pointer_grid.queryDistance(handle, 10.f) == std::vector { &bodies[2] });
+        expect(pointer_grid.removeBody(handle));
+        expect(pointer_grid.getBodyCount() == 1_i);
     };
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include <random>
+
+#include <spatial/grid.hpp>
+#include <boost/ut.hpp>
+
+// Query statistics are compiled in by SPATIAL_ENABLE_STATS, which this test target defines.
+
+struct Body{
+public:
+    std::array<float, 2> position;
+};
+
+struct BodyPositionGetter{
+    spatial::Vector2f operator()(const Body &body) const noexcept{
+        return { body.position[0], body.position[1] };
+    }
+};
+
+using Grid = spatial::Grid<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>>;
+
+int main(){
+    using namespace boost::ut;
+
+    "getQueryStats"_test = []{
+        Grid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::vector<Body> bodies {
+            Body { { 5.f, 5.f } },
+            Body { { 6.f, 5.f } },
+            Body { { 15.f, 5.f } },
+            Body { { 55.f, 55.f } },
+        };
+        std::vector<Grid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+        expect(grid.getQueryStats().queries == 0_i);
+
+        // Circle of radius 2 at (5, 5) covers only cell (0, 0), whose two bodies are tested.
+        grid.queryDistance(handles[0], 2.f, [](Body&){});
+        auto stats = grid.getQueryStats();
+        expect(stats.queries == 1_i);
+        expect(stats.cells_visited == 1_i);
+        expect(stats.candidates_tested == 2_i);
+        expect(stats.candidates_accepted == 1_i);
+
+        // Rectangle from (0, 0) to (15, 15) visits cells (0, 0) to (1, 1). It covers cell (0, 0) entirely, so only the
+        // body in cell (0, 1) is tested.
+        grid.resetQueryStats();
+        expect(grid.queryRect(spatial::FloatRect(0, 0, 15, 15)).size() == 3_i);
+        stats = grid.getQueryStats();
+        expect(stats.queries == 1_i);
+        expect(stats.cells_visited == 4_i);
+        expect(stats.candidates_tested == 1_i);
+        expect(stats.candidates_accepted == 3_i);
+
+        // Moving within a cell updates, and moving to another cell relinks.
+        grid.resetQueryStats();
+        bodies[0].position = { 4.f, 4.f };
+        grid.updateBodyCell(handles[0]);
+        bodies[3].position = { 65.f, 55.f };
+        grid.updateBodyCell(handles[3]);
+        stats = grid.getQueryStats();
+        expect(stats.updates == 2_i);
+        expect(stats.relinks == 1_i);
+    };
+
+    "getQueryStats (pairs)"_test = []{
+        Grid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution dis { 0.f, 100.f };
+        std::vector<Body> bodies;
+        for (int i = 0; i < 1000; ++i) {
+            bodies.push_back(Body { { dis(gen), dis(gen) } });
+        }
+        for (auto &body : bodies) {
+            grid.addBody(&body);
+        }
+
+        // Single and multithreaded queries count the same, and accepted candidates are the found pairs.
+        const auto pair_count = grid.queryDistancePair(5.f).size();
+        const auto stats = grid.getQueryStats();
+        expect(stats.queries == 1_i);
+        expect(stats.cells_visited > 100_i);
+        expect(stats.candidates_accepted == pair_count);
+        expect(stats.candidates_tested >= pair_count);
+
+        grid.resetQueryStats();
+        grid.queryDistancePair(5.f, 4);
+        const auto parallel_stats = grid.getQueryStats();
+        expect(parallel_stats.queries == 1_i);
+        expect(parallel_stats.cells_visited == stats.cells_visited);
+        expect(parallel_stats.candidates_tested == stats.candidates_tested);
+        expect(parallel_stats.candidates_accepted == stats.candidates_accepted);
+    };
+}
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include <spatial/hash_grid.hpp>
+#include <boost/ut.hpp>
+
+struct Body{
+public:
+    std::array<float, 2> position;
+};
+
+struct BodyPositionGetter{
+    spatial::Vector2f operator()(const Body &body) const noexcept{
+        return { body.position[0], body.position[1] };
+    }
+};
+
+using HashGrid = spatial::HashGrid<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>>;
+
+int main(){
+    using namespace boost::ut;
+
+    "HashGrid::HashGrid"_test = []{
+#ifndef NDEBUG
+        expect(throws<std::invalid_argument>([](){
+            HashGrid(spatial::Vector2f { 10.f, 0.f });
+        }));
+#endif
+    };
+
+    "getCellIndex"_test = []{
+        HashGrid grid(spatial::Vector2f { 10.f, 20.f });
+        expect(grid.getCellIndex({ 15.f, 25.f }) == std::array { 1, 1 });
+        expect(grid.getCellIndex({ -0.5f, -25.f }) == std::array { -2, -1 });
+        expect(grid.getCellIndex({ 1e6f, -1e6f }) == std::array { -50000, 100000 });
+
+        // Cells beyond the range of coordinates are clamped to it, and NaN is put in cell (0, 0).
+        constexpr auto coord_max = std::numeric_limits<HashGrid::coord_t>::max();
+        constexpr auto coord_min = std::numeric_limits<HashGrid::coord_t>::min();
+        expect(grid.getCellIndex({ 1e30f, -1e30f }) == std::array { coord_min, coord_max });
+        expect(grid.getCellIndex({ -std::numeric_limits<float>::infinity(), 1e11f }) == std::array { coord_max, coord_min });
+        expect(grid.getCellIndex({ std::nanf(""), 15.f }) == std::array { 0, 0 });
+    };
+
+    "positions out of the range of cells"_test = []{
+        HashGrid grid(spatial::Vector2f { 1.f, 1.f });
+
+        // Both far bodies share the border column of cells.
+        std::vector<Body> bodies {
+            Body { { 3e9f, 0.f } },
+            Body { { 4e9f, 0.f } },
+            Body { { 0.f, 0.f } },
+        };
+        std::vector<HashGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+        expect(grid.getCellCount() == 2_i);
+        expect(grid.getCellBodyCount(0, std::numeric_limits<HashGrid::coord_t>::max()) == 2_i);
+
+        expect(grid.queryDistance(handles[0], 1.f).empty());
+        expect(grid.queryDistancePair(1.f).empty());
+        expect(grid.queryRect(spatial::FloatRect(2.9e9f, -1.f, 3.1e9f, 1.f)) == std::vector<Body*> { &bodies[0] });
+        expect(grid.queryNearest(spatial::Vector2f { 3.9e9f, 0.f }, 1) == std::vector<Body*> { &bodies[1] });
+        expect(grid.queryNearest(handles[2], 1) == std::vector<Body*> { &bodies[0] });
+
+        const auto hit = grid.raycast({ 3.5e9f, 0.f }, { -1.f, 0.f }, std::numeric_limits<float>::infinity(), 1.f);
+        expect(hit.has_value() && hit->body == &bodies[0]);
+        expect(grid.raycastAll({ -10.f, 0.f }, { 1.f, 0.f }, 1e10f, 1.f).size() == 3_i);
+    };
+
+    "addBody"_test = []{
+        HashGrid grid(spatial::Vector2f { 10.f, 10.f });
+
+        // Bodies far apart occupy only their own cells.
+        std::vector<Body> bodies {
+            Body { { 5.f, 5.f } },
+            Body { { 6.f, 7.f } },
+            Body { { 1e6f, 1e6f } },
+            Body { { -1e6f, 3e5f } },
+        };
+        std::vector<HashGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+        expect(grid.getBodyCount() == 4_i);
+        expect(grid.getCellCount() == 3_i);
+        expect(grid.getCellBodyCount(0, 0) == 2_i);
+        expect(grid.getCellBodyCount(100000, 100000) == 1_i);
+
+        bodies[0].position = { -1e6f, 3e5f + 1.f };
+        expect(grid.updateBodyCell(handles[0]) == std::array { 30000, -100000 });
+        expect(grid.getCellBodyCount(0, 0) == 1_i);
+        expect(grid.getCellBodyCount(30000, -100000) == 2_i);
+
+        expect(grid.removeBody(handles[1]));
+        expect(!grid.removeBody(handles[1]));
+        expect(grid.getCellCount() == 2_i); // Cell (0, 0) is removed as it became empty.
+        expect(grid.getCellBodyCount(0, 0) == 0_i);
+
+        grid.clearAllBodies();
+        expect(grid.getBodyCount() == 0_i);
+        expect(grid.getCellCount() == 0_i);
+        expect(!grid.contains(handles[2]));
+    };
+
+    "queries"_test = []{
+        HashGrid grid(spatial::Vector2f { 10.f, 10.f });
+
+        // Bodies along two long roads, with some moving and removed so that table entries are shifted on removal.
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> road_dis(-1e5f, 1e5f);
+        std::uniform_real_distribution<float> width_dis(-20.f, 20.f);
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 3000; ++i) {
+            bodies.push_back(i % 2 == 0 ? Body { { road_dis(gen) / 100.f, width_dis(gen) } } : Body { { width_dis(gen) + 300.f, road_dis(gen) / 100.f } });
+        }
+
+        std::vector<HashGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+        std::vector<bool> removed(bodies.size());
+        for (std::size_t i = 0; i < bodies.size(); i += 7) {
+            grid.removeBody(handles[i]);
+            removed[i] = true;
+        }
+        for (std::size_t i = 1; i < bodies.size(); i += 5) {
+            bodies[i].position[0] += width_dis(gen);
+            bodies[i].position[1] += width_dis(gen);
+            if (!removed[i]) {
+                grid.updateBodyCell(handles[i]);
+            }
+        }
+
+        for (float distance : { 1.f, 7.f, 25.f }) {
+            std::size_t expected = 0;
+            for (std::size_t i = 0; i < bodies.size(); ++i) {
+                for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                    expected += !removed[i] && !removed[j] && BodyPositionGetter()(bodies[i]).distance2(BodyPositionGetter()(bodies[j])) <= distance * distance;
+                }
+            }
+
+            auto pairs = grid.queryDistancePair(distance);
+            for (auto &pair : pairs) {
+                std::ranges::sort(pair);
+            }
+            std::ranges::sort(pairs);
+            expect(pairs.size() == expected);
+            expect(std::ranges::adjacent_find(pairs) == pairs.end()); // Each pair appears once.
+
+            for (std::size_t i = 1; i < bodies.size(); i += 97) {
+                if (removed[i]) {
+                    continue;
+                }
+
+                std::size_t expected_nearby = 0;
+                for (std::size_t j = 0; j < bodies.size(); ++j) {
+                    expected_nearby += j != i && !removed[j] && BodyPositionGetter()(bodies[i]).distance2(BodyPositionGetter()(bodies[j])) <= distance * distance;
+                }
+                expect(grid.queryDistance(handles[i], distance).size() == expected_nearby);
+                expect(grid.queryDistance(bodies[i], distance).size() == expected_nearby);
+            }
+        }
+
+        for (const auto &rect : { spatial::FloatRect(-100, -10, 100, 10), spatial::FloatRect(-1e6f, -1e6f, 1e6f, 1e6f), spatial::FloatRect(290, 0, 310, 5) }) {
+            std::size_t expected = 0;
+            for (std::size_t i = 0; i < bodies.size(); ++i) {
+                expected += !removed[i] && rect.contains(BodyPositionGetter()(bodies[i]));
+            }
+            expect(grid.queryRect(rect).size() == expected);
+
+            std::size_t visited = 0;
+            grid.queryRect(rect, [&](Body&){ ++visited; });
+            expect(visited == expected);
+        }
+    };
+
+    "raycast"_test = []{
+        HashGrid grid(spatial::Vector2f { 10.f, 10.f });
+        expect(!grid.raycast({ 0.f, 0.f }, { 1.f, 1.f }, 200.f, 1.f).has_value());
+
+        // A cluster around the origin and a few bodies far away, so that long rays fall back to scanning the table.
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis(-50.f, 50.f);
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 300; ++i) {
+            bodies.push_back(Body { { dis(gen), dis(gen) } });
+        }
+        bodies.push_back(Body { { 1e5f, 0.f } });
+        bodies.push_back(Body { { -3e4f, -3e4f } });
+        for (auto &body : bodies) {
+            grid.addBody(&body);
+        }
+
+        // Distances where ray hits each body by brute force.
+        const auto brute_force = [&](const spatial::Vector2f &origin, const spatial::Vector2f &direction, float max_distance, float radius){
+            const auto unit_direction = direction * (1.f / std::hypot(direction.x, direction.y));
+            std::vector<float> distances;
+            for (const auto &body : bodies) {
+                const auto to_body = BodyPositionGetter()(body) - origin;
+                const auto projection = to_body.dot(unit_direction);
+                const auto perpendicular_square = to_body.dot(to_body) - projection * projection;
+                if (perpendicular_square > radius * radius) {
+                    continue;
+                }
+                auto t = projection - std::sqrt(radius * radius - perpendicular_square);
+                if (t < 0 && to_body.dot(to_body) > radius * radius) {
+                    continue;
+                }
+                if (std::max(t, 0.f) <= max_distance) {
+                    distances.push_back(std::max(t, 0.f));
+                }
+            }
+            std::ranges::sort(distances);
+            return distances;
+        };
+
+        std::uniform_real_distribution<float> origin_dis(-70.f, 70.f);
+        std::uniform_real_distribution<float> direction_dis(-1.f, 1.f);
+        for (auto i = 0; i < 200; ++i) {
+            const spatial::Vector2f origin { origin_dis(gen), origin_dis(gen) };
+            spatial::Vector2f direction { direction_dis(gen), direction_dis(gen) };
+            if (i % 10 == 0) {
+                direction = { i % 20 == 0 ? 1.f : 0.f, i % 20 == 0 ? 0.f : -1.f }; // Axis-aligned ray.
+            }
+            const auto max_distance = i % 3 == 0 ? 40.f : i % 3 == 1 ? 300.f : std::numeric_limits<float>::infinity();
+            const auto radius = i % 4 == 0 ? 0.5f : 13.f;
+
+            const auto expected = brute_force(origin, direction, max_distance, radius);
+            const auto hits = grid.raycastAll(origin, direction, max_distance, radius);
+            expect(hits.size() == expected.size());
+
+            const auto hit = grid.raycast(origin, direction, max_distance, radius);
+            expect(hit.has_value() == !expected.empty());
+            if (hit && !expected.empty()) {
+                expect(std::abs(hit->distance - expected.front()) < 1e-3f);
+            }
+        }
+
+        // Ray towards the far body is answered without walking every cell on the way.
+        const auto far_hit = grid.raycast({ 9e4f, 0.f }, { 1.f, 0.f }, std::numeric_limits<float>::infinity(), 1.f);
+        expect(far_hit.has_value() && far_hit->body == &bodies[300]);
+    };
+
+    "queryNearest"_test = []{
+        HashGrid grid(spatial::Vector2f { 10.f, 10.f });
+        expect(grid.queryNearest(spatial::Vector2f { 50.f, 50.f }, 3).empty());
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> dis(-50.f, 50.f);
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 500; ++i) {
+            bodies.push_back(Body { { dis(gen), dis(gen) } });
+        }
+        bodies.push_back(Body { { 1e5f, 0.f } });
+        bodies.push_back(Body { { -3e4f, -3e4f } });
+        std::vector<HashGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+
+        // Distances of the k nearest bodies by brute force.
+        const auto brute_force = [&](const spatial::Vector2f &position, std::size_t k, const Body *excluded){
+            std::vector<float> distances;
+            for (const auto &body : bodies) {
+                if (&body != excluded) {
+                    distances.push_back(position.distance2(BodyPositionGetter()(body)));
+                }
+            }
+            std::ranges::sort(distances);
+            distances.resize(std::min(k, distances.size()));
+            return distances;
+        };
+        const auto distances_of = [](const spatial::Vector2f &position, const std::vector<Body*> &result){
+            std::vector<float> distances;
+            for (const auto body : result) {
+                distances.push_back(position.distance2(BodyPositionGetter()(*body)));
+            }
+            return distances;
+        };
+
+        for (spatial::Vector2f position : { spatial::Vector2f { 0.f, 0.f }, spatial::Vector2f { -49.5f, 49.f }, spatial::Vector2f { -300.f, 140.f }, spatial::Vector2f { 1e5f, 5.f } }) {
+            for (std::size_t k : { 1, 7, 60, 1000 }) {
+                expect(distances_of(position, grid.queryNearest(position, k)) == brute_force(position, k, nullptr));
+            }
+        }
+
+        // Body itself is excluded when querying by handle, also for the far body whose neighbors are scanned.
+        for (std::size_t i = 0; i < bodies.size(); i += 50) {
+            const auto position = BodyPositionGetter()(bodies[i]);
+            const auto nearest = grid.queryNearest(handles[i], 5);
+            expect(std::ranges::find(nearest, &bodies[i]) == nearest.end());
+            expect(distances_of(position, nearest) == brute_force(position, 5, &bodies[i]));
+        }
+        const auto far_nearest = grid.queryNearest(handles[500], 1);
+        expect(far_nearest.size() == 1_i && far_nearest.front() != &bodies[500]);
+    };
+}
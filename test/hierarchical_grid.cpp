@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <random>
+
+#include <spatial/hierarchical_grid.hpp>
+#include <boost/ut.hpp>
+
+#include "bounds_body.hpp"
+
+using HierarchicalGrid = spatial::HierarchicalGrid<float, Body, BodyBoundsGetter, spatial::PointerBodyStorage<Body>>;
+
+int main(){
+    using namespace boost::ut;
+
+    "HierarchicalGrid::HierarchicalGrid"_test = []{
+#ifndef NDEBUG
+        expect(throws<std::invalid_argument>([](){
+            HierarchicalGrid(spatial::FloatRect(0, 0, 100, 100), 16, 16, 0, 4);
+        }));
+#endif
+        HierarchicalGrid grid(spatial::FloatRect(0, 0, 100, 100), 16, 12, 4, 4);
+        expect(grid.getLevelCount() == 4_i);
+        expect(grid.getLevel(0).getRowCount() == 16_i);
+        expect(grid.getLevel(2).getColumnCount() == 3_i);
+        expect(grid.getLevel(3).getRowCount() == 2_i);
+    };
+
+    "addBody"_test = []{
+        HierarchicalGrid grid(spatial::FloatRect(0, 0, 160, 160), 16, 16, 4, 2); // Cell sizes are 10, 20, 40 and 80.
+
+        // Dense cluster fills the coarsest cell first, and spills down into finer levels.
+        std::vector<Body> cluster(8, Body { { 45.f, 45.f }, 0.5f });
+        std::vector<HierarchicalGrid::BodyHandle> handles;
+        for (auto &body : cluster) {
+            handles.push_back(grid.addBody(&body));
+        }
+        expect(grid.getBodyLevel(handles[0]) == 3_i);
+        expect(grid.getBodyLevel(handles[1]) == 3_i);
+        expect(grid.getBodyLevel(handles[2]) == 2_i);
+        expect(grid.getBodyLevel(handles[6]) == 0_i);
+        expect(grid.getBodyLevel(handles[7]) == 0_i); // The finest level takes all the rest.
+
+        // Large body cannot go to the levels whose cells are smaller than it.
+        Body large { { 100.f, 100.f }, 15.f };
+        auto large_handle = grid.addBody(&large);
+        expect(grid.getBodyLevel(large_handle) == 3_i);
+
+        // Body moves to a coarser level when it grows larger than the cells of its level.
+        Body growing { { 130.f, 130.f }, 1.f };
+        std::vector<Body> fillers(2, Body { { 130.f, 130.f }, 1.f });
+        for (auto &body : fillers) {
+            grid.addBody(&body);
+        }
+        auto growing_handle = grid.addBody(&growing);
+        expect(grid.getBodyLevel(growing_handle) == 2_i);
+        growing.half_size = 30.f;
+        grid.updateBodyCell(growing_handle);
+        expect(grid.getBodyLevel(growing_handle) == 3_i);
+        expect(grid.contains(growing_handle));
+        expect(&grid.getBody(growing_handle) == &growing);
+
+        expect(grid.getBodyCount() == 12_i);
+        expect(grid.removeBody(large_handle));
+        expect(!grid.contains(large_handle));
+        expect(grid.getBodyCount() == 11_i);
+
+        grid.clearAllBodies();
+        expect(grid.getBodyCount() == 0_i);
+        expect(!grid.contains(handles[0]));
+    };
+
+    "updateBodyCell into a cluster"_test = []{
+        HierarchicalGrid grid(spatial::FloatRect(0, 0, 160, 160), 16, 16, 4, 2); // Cell sizes are 10, 20, 40 and 80.
+
+        // Bodies spread over the bound take the coarse levels.
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 16; ++i) {
+            bodies.push_back(Body { { 20.f + 40.f * static_cast<float>(i % 4), 20.f + 40.f * static_cast<float>(i / 4) }, 0.5f });
+        }
+        std::vector<Body*> body_pointers;
+        std::vector<HierarchicalGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            body_pointers.push_back(&body);
+            handles.push_back(grid.addBody(&body));
+        }
+        expect(std::ranges::none_of(handles, [&](auto handle){ return grid.getBodyLevel(handle) < 2; }));
+
+        // Bodies moving into a full cell spill down into finer levels, so no cell but the finest ones goes over the
+        // capacity.
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            bodies[i].position = { 45.f, 45.f };
+            grid.updateBodyCell(handles[i]);
+        }
+        expect(grid.getLevel(3).getCellBodyCount(0, 0) == 2_i);
+        expect(grid.getLevel(2).getCellBodyCount(1, 1) == 2_i);
+        expect(grid.getLevel(1).getCellBodyCount(2, 2) == 2_i);
+        expect(grid.getLevel(0).getCellBodyCount(4, 4) == 10_i);
+        for (std::size_t level = 1; level < grid.getLevelCount(); ++level) {
+            const auto &level_grid = grid.getLevel(level);
+            for (std::size_t row = 0; row < level_grid.getRowCount(); ++row) {
+                for (std::size_t col = 0; col < level_grid.getColumnCount(); ++col) {
+                    expect(level_grid.getCellBodyCount(row, col) <= 2_i);
+                }
+            }
+        }
+        expectQueriesMatchBruteForce(grid, body_pointers, handles, { spatial::FloatRect(40, 40, 50, 50), spatial::FloatRect(0, 0, 40, 40) });
+    };
+
+    "queries"_test = []{
+        HierarchicalGrid grid(spatial::FloatRect(0, 0, 100, 100), 32, 32, 5, 4);
+
+        // Clustered bodies of various sizes.
+        std::mt19937 gen(0);
+        std::normal_distribution<float> cluster_dis(0.f, 3.f);
+        std::uniform_real_distribution<float> position_dis(0.f, 100.f);
+        std::uniform_real_distribution<float> size_dis(0.1f, 10.f);
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 400; ++i) {
+            if (i % 4 == 0) {
+                bodies.push_back(Body { { position_dis(gen), position_dis(gen) }, size_dis(gen) });
+            }
+            else {
+                bodies.push_back(Body { { std::clamp(30.f + cluster_dis(gen), 0.f, 99.f), std::clamp(70.f + cluster_dis(gen), 0.f, 99.f) }, 0.2f });
+            }
+        }
+
+        std::vector<Body*> body_pointers;
+        std::vector<HierarchicalGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            body_pointers.push_back(&body);
+            handles.push_back(grid.addBody(&body));
+        }
+        expectQueriesMatchBruteForce(grid, body_pointers, handles,
+                                     { spatial::FloatRect(25, 65, 35, 75), spatial::FloatRect(-10, -10, 200, 200), spatial::FloatRect(60, 10, 61, 90) });
+    };
+
+    "cross-level pairs"_test = []{
+        // With no capacity, each body is in the finest level it fits in. Cell sizes are 10, 20, 40 and 80.
+        HierarchicalGrid grid(spatial::FloatRect(0, 0, 160, 160), 16, 16, 4, 0);
+
+        Body fine { { 70.f, 60.f }, 1.f }; // Level 0, overlapping all the others.
+        Body large1 { { 60.f, 60.f }, 15.f }; // Level 2.
+        Body large2 { { 80.f, 60.f }, 15.f }; // Level 2.
+        Body huge { { 70.f, 70.f }, 35.f }; // Level 3, the coarsest one.
+        Body apart { { 140.f, 140.f }, 1.f }; // Level 0, overlapping nothing.
+        std::vector<Body*> body_pointers { &fine, &large1, &large2, &huge, &apart };
+        std::vector<HierarchicalGrid::BodyHandle> handles;
+        for (auto *body : body_pointers) {
+            handles.push_back(grid.addBody(body));
+        }
+        expect(grid.getBodyLevel(handles[0]) == 0_i);
+        expect(grid.getBodyLevel(handles[1]) == 2_i);
+        expect(grid.getBodyLevel(handles[2]) == 2_i);
+        expect(grid.getBodyLevel(handles[3]) == 3_i);
+        expect(grid.getBodyLevel(handles[4]) == 0_i);
+
+        // Fine body pairs with bodies of two coarser levels, besides the pairs within and between them.
+        auto pairs = grid.queryOverlapPair();
+        expect(pairs.size() == 6_i);
+        expect(std::ranges::count_if(pairs, [&](const auto &pair){ return pair[0] == &fine || pair[1] == &fine; }) == 3_i);
+
+        // Body in the coarsest level finds bodies in all finer levels, except itself.
+        auto overlapping = grid.queryOverlap(handles[3]);
+        std::ranges::sort(overlapping);
+        std::vector<Body*> expected { &fine, &large1, &large2 };
+        std::ranges::sort(expected);
+        expect(overlapping == expected);
+
+        expectQueriesMatchBruteForce(grid, body_pointers, handles, { spatial::FloatRect(69, 59, 71, 61), spatial::FloatRect(100, 100, 160, 160) });
+    };
+
+    "updateBodyCell across levels"_test = []{
+        HierarchicalGrid grid(spatial::FloatRect(0, 0, 160, 160), 16, 16, 4, 0);
+
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 16; ++i) {
+            bodies.push_back(Body { { 5.f + 10.f * static_cast<float>(i), 50.f }, 2.f });
+        }
+        std::vector<Body*> body_pointers;
+        std::vector<HierarchicalGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            body_pointers.push_back(&body);
+            handles.push_back(grid.addBody(&body));
+        }
+
+        // Body grows out of the finest level into the coarsest one, ...
+        bodies[5].half_size = 30.f;
+        grid.updateBodyCell(handles[5]);
+        expect(grid.getBodyLevel(handles[5]) == 3_i);
+
+        // ... and returns to the finest level when it shrinks and moves, as its cell is over the capacity.
+        bodies[5].half_size = 2.f;
+        bodies[5].position = { 100.f, 100.f };
+        grid.updateBodyCell(handles[5]);
+        expect(grid.getBodyLevel(handles[5]) == 0_i);
+
+        // Another body moves to a middle level, and one of the rest is removed, whose slot is reused.
+        bodies[9].half_size = 8.f;
+        grid.updateBodyCell(handles[9]);
+        expect(grid.getBodyLevel(handles[9]) == 1_i);
+        expect(grid.removeBody(handles[12]));
+        Body added { { 120.f, 52.f }, 4.f };
+        const auto added_handle = grid.addBody(&added);
+        expect(!grid.contains(handles[12]));
+        body_pointers[12] = &added;
+        handles[12] = added_handle;
+
+        // Handles of all other bodies still refer to their bodies.
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            expect(grid.contains(handles[i]));
+            expect(&grid.getBody(handles[i]) == body_pointers[i]);
+            if (i != 9 && i != 12) {
+                expect(grid.getBodyLevel(handles[i]) == 0_i);
+            }
+        }
+        expectQueriesMatchBruteForce(grid, body_pointers, handles, { spatial::FloatRect(90, 40, 110, 110), spatial::FloatRect(0, 0, 160, 160) });
+    };
+}
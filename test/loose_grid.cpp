@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <random>
+
+#include <spatial/loose_grid.hpp>
+#include <boost/ut.hpp>
+
+#include "bounds_body.hpp"
+
+using LooseGrid = spatial::LooseGrid<float, Body, BodyBoundsGetter, spatial::PointerBodyStorage<Body>>;
+
+int main(){
+    using namespace boost::ut;
+
+    "LooseGrid::LooseGrid"_test = []{
+        const LooseGrid grid(spatial::FloatRect(0, 0, 100, 100), 20, 10);
+        expect(grid.getRowCount() == 20_i);
+        expect(grid.getColumnCount() == 10_i);
+
+#ifndef NDEBUG
+        expect(throws<std::invalid_argument>([](){
+            LooseGrid(spatial::FloatRect(0, 0, 100, 100), 1, 0);
+        }));
+#endif
+    };
+
+    "addBody"_test = []{
+        LooseGrid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        Body small { { 15.f, 15.f }, 1.f }; // (1, 1)
+        Body large { { 50.f, 50.f }, 25.f }; // (5, 5), stored once regardless of its size.
+        Body outside { { -20.f, 50.f }, 5.f }; // Clamped to (5, 0)
+
+        const auto small_handle = grid.addBody(&small);
+        const auto large_handle = grid.addBody(&large);
+        const auto outside_handle = grid.addBody(&outside);
+        expect(grid.getBodyCount() == 3_i);
+        expect(grid.getCellIndex(small_handle) == std::array<std::size_t, 2> { 1, 1 });
+        expect(grid.getCellIndex(large_handle) == std::array<std::size_t, 2> { 5, 5 });
+        expect(grid.getCellIndex(outside_handle) == std::array<std::size_t, 2> { 5, 0 });
+        expect(grid.maxHalfSize() == spatial::Vector2f { 25.f, 25.f });
+
+        expect(grid.removeBody(large_handle));
+        expect(!grid.removeBody(large_handle));
+        expect(!grid.contains(large_handle));
+        expect(grid.getBodyCount() == 2_i);
+
+        grid.clearAllBodies();
+        expect(grid.getBodyCount() == 0_i);
+        expect(grid.maxHalfSize() == spatial::Vector2f { 0.f, 0.f });
+        expect(!grid.contains(small_handle));
+    };
+
+    "largest body removed or shrunk"_test = []{
+        LooseGrid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> position_dis(0.f, 100.f);
+        std::uniform_real_distribution<float> size_dis(0.5f, 4.f);
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 200; ++i) {
+            bodies.push_back(Body { { position_dis(gen), position_dis(gen) }, size_dis(gen) });
+        }
+        Body largest { { 50.f, 50.f }, 30.f };
+        Body shrinking { { 20.f, 80.f }, 20.f };
+
+        std::vector<Body*> body_pointers;
+        std::vector<LooseGrid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            body_pointers.push_back(&body);
+            handles.push_back(grid.addBody(&body));
+        }
+        const auto largest_handle = grid.addBody(&largest);
+        body_pointers.push_back(&shrinking);
+        handles.push_back(grid.addBody(&shrinking));
+        expect(grid.maxHalfSize() == spatial::Vector2f { 30.f, 30.f });
+
+        // Largest half size is kept after the largest body is gone, which only widens the scanned cells.
+        expect(grid.removeBody(largest_handle));
+        expect(grid.maxHalfSize() == spatial::Vector2f { 30.f, 30.f });
+        expectQueriesMatchBruteForce(grid, body_pointers, handles, { spatial::FloatRect(45, 45, 55, 55), spatial::FloatRect(0, 60, 40, 100) });
+
+        shrinking.half_size = 1.f;
+        grid.updateBodyCell(handles.back());
+        expect(grid.maxHalfSize() == spatial::Vector2f { 30.f, 30.f });
+        expectQueriesMatchBruteForce(grid, body_pointers, handles, { spatial::FloatRect(45, 45, 55, 55), spatial::FloatRect(0, 60, 40, 100) });
+    };
+
+    "pairs of bodies several cells apart"_test = []{
+        // Cells are 5 wide, and bodies are up to 12 in half size, so overlapping centers are up to 5 cells apart.
+        LooseGrid grid(spatial::FloatRect(0, 0, 100, 100), 20, 20);
+
+        Body center { { 52.5f, 52.5f }, 12.f }; // (10, 10)
+        Body lower_left { { 32.5f, 72.5f }, 12.f }; // (14, 6), overlapping center by 4 in both axes.
+        Body right { { 75.f, 52.5f }, 11.f }; // (10, 15), overlapping center by 0.5 in x.
+        Body far { { 52.5f, 80.f }, 2.f }; // (16, 10), not overlapping anything.
+        std::vector<Body*> body_pointers { &center, &lower_left, &right, &far };
+        std::vector<LooseGrid::BodyHandle> handles;
+        for (auto *body : body_pointers) {
+            handles.push_back(grid.addBody(body));
+        }
+
+        const auto pairs = grid.queryOverlapPair();
+        expect(pairs.size() == 2_i);
+        expect(std::ranges::any_of(pairs, [&](const auto &pair){
+            return (pair[0] == &center && pair[1] == &lower_left) || (pair[0] == &lower_left && pair[1] == &center);
+        }));
+        expect(std::ranges::any_of(pairs, [&](const auto &pair){
+            return (pair[0] == &center && pair[1] == &right) || (pair[0] == &right && pair[1] == &center);
+        }));
+
+        // Large bodies among small ones, so the reach spans several cells in every direction.
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<float> position_dis(0.f, 100.f);
+        std::uniform_real_distribution<float> size_dis(0.2f, 12.f);
+        std::vector<Body> bodies;
+        for (auto i = 0; i < 300; ++i) {
+            bodies.push_back(Body { { position_dis(gen), position_dis(gen) }, i % 10 == 0 ? size_dis(gen) : 0.3f });
+        }
+        for (auto &body : bodies) {
+            body_pointers.push_back(&body);
+            handles.push_back(grid.addBody(&body));
+        }
+        expectQueriesMatchBruteForce(grid, body_pointers, handles, { spatial::FloatRect(10, 10, 12, 12), spatial::FloatRect(30, 0, 31, 100) });
+    };
+
+    "bodies centered out of bound"_test = []{
+        LooseGrid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        Body left { { -20.f, 50.f }, 25.f }; // Clamped to (5, 0), reaching into bound up to x = 5.
+        Body lower_right { { 130.f, 130.f }, 40.f }; // Clamped to (9, 9), reaching into bound from (90, 90).
+        Body above { { 50.f, -30.f }, 5.f }; // Clamped to (0, 5), entirely out of bound.
+        Body inside { { 3.f, 50.f }, 1.f }; // (5, 0), overlapping left.
+        std::vector<Body*> body_pointers { &left, &lower_right, &above, &inside };
+        std::vector<LooseGrid::BodyHandle> handles;
+        for (auto *body : body_pointers) {
+            handles.push_back(grid.addBody(body));
+        }
+        expect(grid.getCellIndex(handles[1]) == std::array<std::size_t, 2> { 9, 9 });
+        expect(grid.getCellIndex(handles[2]) == std::array<std::size_t, 2> { 0, 5 });
+
+        // Rectangles entirely out of bound still find bodies clamped into the border cells.
+        expect(grid.queryRect(spatial::FloatRect(-50, 40, -30, 60)) == std::vector<Body*> { &left });
+        expect(grid.queryRect(spatial::FloatRect(150, 150, 160, 160)) == std::vector<Body*> { &lower_right });
+        expect(grid.queryRect(spatial::FloatRect(45, -40, 55, -35)) == std::vector<Body*> { &above });
+        expect(grid.queryRect(spatial::FloatRect(95, 95, 99, 99)) == std::vector<Body*> { &lower_right });
+        expect(grid.queryRect(spatial::FloatRect(-100, 60, -50, 100)).empty());
+
+        expectQueriesMatchBruteForce(grid, body_pointers, handles,
+                                     { spatial::FloatRect(-50, -50, 0, 10), spatial::FloatRect(-10, -10, 200, 200), spatial::FloatRect(100, 0, 200, 100) });
+    };
+}
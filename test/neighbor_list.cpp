@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <random>
+
+#include <spatial/neighbor_list.hpp>
+#include <boost/ut.hpp>
+
+struct Body{
+public:
+    std::array<float, 2> position;
+};
+
+struct BodyPositionGetter{
+    spatial::Vector2f operator()(const Body &body) const noexcept{
+        return { body.position[0], body.position[1] };
+    }
+};
+
+using Grid = spatial::Grid<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>>;
+using NeighborList = spatial::NeighborList<float, Body, BodyPositionGetter, spatial::PointerBodyStorage<Body>>;
+
+int main(){
+    using namespace boost::ut;
+
+    "NeighborList::NeighborList"_test = []{
+#ifndef NDEBUG
+        expect(throws<std::invalid_argument>([](){
+            NeighborList(-1.f, 1.f);
+        }));
+        expect(throws<std::invalid_argument>([](){
+            NeighborList(1.f, -1.f);
+        }));
+#endif
+    };
+
+    "build"_test = []{
+        Grid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10);
+
+        std::vector<Body> bodies {
+            Body { { 10.f, 10.f } },
+            Body { { 13.f, 10.f } }, // 3 from body 0.
+            Body { { 10.f, 14.5f } }, // 4.5 from body 0.
+            Body { { 50.f, 50.f } },
+        };
+        std::vector<Grid::BodyHandle> handles;
+        for (auto &body : bodies) {
+            handles.push_back(grid.addBody(&body));
+        }
+
+        NeighborList neighbor_list(4.f, 1.f);
+        expect(neighbor_list.needsRebuild(grid));
+        expect(neighbor_list.update(grid));
+        expect(neighbor_list.getBuildCount() == 1_i);
+
+        // Lists hold bodies within radius + skin, while queries return bodies within radius.
+        expect(neighbor_list.getNeighbors(handles[0]).size() == 2_i);
+        expect(neighbor_list.getNeighbors(handles[3]).empty());
+
+        std::size_t visited = 0;
+        neighbor_list.queryDistance(grid, handles[0], [&](Body &body){
+            expect(&body == &bodies[1]);
+            ++visited;
+        });
+        expect(visited == 1_i);
+
+        // Moving less than skin / 2 does not rebuild, and queries use current positions.
+        bodies[2].position = { 10.f, 14.f };
+        grid.updateBodyCell(handles[2]);
+        expect(!neighbor_list.update(grid));
+        visited = 0;
+        neighbor_list.queryDistance(grid, handles[0], [&](Body&){ ++visited; });
+        expect(visited == 2_i);
+
+        // Moving more than skin / 2 rebuilds.
+        bodies[3].position = { 50.f, 51.f };
+        grid.updateBodyCell(handles[3]);
+        expect(neighbor_list.update(grid));
+        expect(neighbor_list.getBuildCount() == 2_i);
+
+        // Adding or removing body rebuilds.
+        grid.removeBody(handles[3]);
+        expect(neighbor_list.update(grid));
+        Body body { { 11.f, 11.f } };
+        handles[3] = grid.addBody(&body); // Reuses the slot of the removed body.
+        expect(neighbor_list.update(grid));
+        expect(neighbor_list.getNeighbors(handles[3]).size() == 3_i);
+        expect(!neighbor_list.update(grid));
+    };
+
+    "queryDistancePair"_test = []{
+        for (auto boundary : { spatial::GridBoundary::Bounded, spatial::GridBoundary::Periodic }) {
+            Grid grid(spatial::FloatRect(0, 0, 100, 100), 10, 10, boundary);
+
+            std::mt19937 gen(0);
+            std::uniform_real_distribution dis { 0.f, 100.f };
+            std::uniform_real_distribution step_dis { -0.3f, 0.3f };
+            std::vector<Body> bodies;
+            for (int i = 0; i < 1000; ++i) {
+                bodies.push_back(Body { { dis(gen), dis(gen) } });
+            }
+            std::vector<Grid::BodyHandle> handles;
+            for (auto &body : bodies) {
+                handles.push_back(grid.addBody(&body));
+            }
+
+            const auto distance2 = [&](const Body &body1, const Body &body2){
+                auto dx = std::abs(body1.position[0] - body2.position[0]);
+                auto dy = std::abs(body1.position[1] - body2.position[1]);
+                if (boundary == spatial::GridBoundary::Periodic) {
+                    dx = std::min(dx, 100.f - dx);
+                    dy = std::min(dy, 100.f - dy);
+                }
+                return dx * dx + dy * dy;
+            };
+
+            NeighborList neighbor_list(5.f, 1.f);
+            for (int step = 0; step < 20; ++step) {
+                for (std::size_t i = 0; i < bodies.size(); ++i) {
+                    auto &position = bodies[i].position;
+                    position[0] = std::clamp(position[0] + step_dis(gen), 0.f, 99.9f);
+                    position[1] = std::clamp(position[1] + step_dis(gen), 0.f, 99.9f);
+                    grid.updateBodyCell(handles[i]);
+                }
+                neighbor_list.update(grid);
+
+                std::size_t expected = 0;
+                for (std::size_t i = 0; i < bodies.size(); ++i) {
+                    for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                        expected += distance2(bodies[i], bodies[j]) <= 25.f;
+                    }
+                }
+
+                std::vector<std::array<const Body*, 2>> pairs;
+                neighbor_list.queryDistancePair(grid, [&](Body &body1, Body &body2){
+                    pairs.push_back({ std::min(&body1, &body2), std::max(&body1, &body2) });
+                });
+                std::ranges::sort(pairs);
+                expect(pairs.size() == expected);
+                expect(std::ranges::adjacent_find(pairs) == pairs.end()); // Each pair appears once.
+            }
+
+            // Bodies move at most 0.3 * sqrt(2) per step, so lists are not rebuilt at every step.
+            expect(neighbor_list.getBuildCount() < 20_i);
+        }
+    };
+}